@@ -0,0 +1,462 @@
+#include <chrono>
+#include <cstdio>
+#include <cstddef>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "tree-search.hpp"
+#include "headless/headless-view.hpp"
+
+/*
+ * Microbenchmarks of the tiling tree, run headless on synthetic trees.
+ *
+ * For each tree shape and operation, the time per operation, the heap
+ * allocations per operation and the number of views put in a transaction per
+ * operation are reported. Mutations are always followed by a layout pass,
+ * since that is where their cost is paid.
+ */
+
+/* --------------------------- Allocation counter --------------------------- */
+static uint64_t num_allocations = 0;
+
+/*
+ * All replaceable global allocation functions are replaced, so that array and
+ * over-aligned allocations are counted as well, and every allocation is freed
+ * by the matching function.
+ */
+static void *counted_alloc(std::size_t size, std::size_t alignment = 0) noexcept
+{
+    ++num_allocations;
+    size = size ? size : 1;
+    if (alignment <= alignof(std::max_align_t))
+    {
+        return std::malloc(size);
+    }
+
+    /* aligned_alloc() needs a size which is a multiple of the alignment */
+    size = (size + alignment - 1) / alignment * alignment;
+    return std::aligned_alloc(alignment, size);
+}
+
+static void *counted_alloc_or_throw(std::size_t size, std::size_t alignment = 0)
+{
+    if (void *ptr = counted_alloc(size, alignment))
+    {
+        return ptr;
+    }
+
+    throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size)
+{
+    return counted_alloc_or_throw(size);
+}
+
+void *operator new[](std::size_t size)
+{
+    return counted_alloc_or_throw(size);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+    return counted_alloc_or_throw(size, (std::size_t)alignment);
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return counted_alloc_or_throw(size, (std::size_t)alignment);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return counted_alloc(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return counted_alloc(size);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment,
+    const std::nothrow_t&) noexcept
+{
+    return counted_alloc(size, (std::size_t)alignment);
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment,
+    const std::nothrow_t&) noexcept
+{
+    return counted_alloc(size, (std::size_t)alignment);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t&) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t&) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    std::free(ptr);
+}
+
+namespace
+{
+using namespace wf::tile;
+
+static constexpr wf::geometry_t root_geometry = {0, 0, 3840, 2160};
+
+/* -------------------------------- Trees ---------------------------------- */
+struct bench_tree_t
+{
+    std::string name;
+    std::unique_ptr<tree_node_t> root;
+    /** The split into which nodes are added and removed */
+    nonstd::observer_ptr<split_node_t> target;
+};
+
+std::unique_ptr<split_node_t> make_root()
+{
+    auto root = std::make_unique<split_node_t>(SPLIT_VERTICAL);
+    root->set_geometry(root_geometry);
+    return root;
+}
+
+/** One split with 500 views */
+bench_tree_t make_wide()
+{
+    auto root = make_root();
+    for (int i = 0; i < 500; i++)
+    {
+        root->add_child(headless::create_view_node());
+    }
+
+    auto target = nonstd::make_observer(root.get());
+    return {"wide", std::move(root), target};
+}
+
+/**
+ * 50 nested splits of alternating direction, each with a view. The views get
+ * a twentieth of their split, so that even the innermost nodes have a real
+ * size, about a quarter of the root.
+ */
+bench_tree_t make_deep()
+{
+    auto root = make_root();
+    auto split = nonstd::make_observer(root.get());
+    /* The innermost split which has two children */
+    nonstd::observer_ptr<split_node_t> target;
+    for (int i = 0; i < 50; i++)
+    {
+        split->add_child(headless::create_view_node());
+
+        auto dir = (split->get_split_direction() == SPLIT_VERTICAL) ?
+            SPLIT_HORIZONTAL : SPLIT_VERTICAL;
+        auto child = std::make_unique<split_node_t>(dir);
+        auto next  = nonstd::make_observer(child.get());
+        split->add_child(std::move(child));
+
+        /* The first layout keeps these proportions */
+        split->get_child(0)->set_geometry({0, 0, 1, 1});
+        next->set_geometry({0, 0, 19, 19});
+        target = split;
+        split  = next;
+    }
+
+    split->add_child(headless::create_view_node());
+    return {"deep", std::move(root), target};
+}
+
+/** Columns of stacked views, every third column being tabbed */
+bench_tree_t make_mixed()
+{
+    auto root = make_root();
+    for (int i = 0; i < 8; i++)
+    {
+        auto column = std::make_unique<split_node_t>(SPLIT_HORIZONTAL);
+        column->set_tabbed(i % 3 == 2);
+        for (int j = 0; j < 4; j++)
+        {
+            if (j == 1)
+            {
+                auto row = std::make_unique<split_node_t>(SPLIT_VERTICAL);
+                row->add_child(headless::create_view_node());
+                row->add_child(headless::create_view_node());
+                column->add_child(std::move(row));
+            } else
+            {
+                column->add_child(headless::create_view_node());
+            }
+        }
+
+        root->add_child(std::move(column));
+    }
+
+    auto target = root->get_child(4)->as_split_node();
+    return {"mixed", std::move(root), target};
+}
+
+/* ------------------------------ Measuring -------------------------------- */
+struct measurement_t
+{
+    uint64_t ops = 0;
+    uint64_t ns  = 0;
+    uint64_t allocations = 0;
+    uint64_t tx_objects  = 0;
+};
+
+/** Lay out the tree, counting the configured views */
+void layout(bench_tree_t& tree, measurement_t& m)
+{
+    headless::headless_transaction_t tx;
+    layout_tree(tree.root, tx);
+    tx.apply();
+    m.tx_objects += tx.num_views;
+}
+
+/**
+ * Run op ops times. The time and allocations of the whole run are counted,
+ * op itself accounts for the transaction objects.
+ */
+measurement_t measure(int ops, std::function<void(int, measurement_t&)> op)
+{
+    measurement_t m;
+    m.ops = ops;
+
+    uint64_t allocations_before = num_allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ops; i++)
+    {
+        op(i, m);
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    m.ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    m.allocations = num_allocations - allocations_before;
+    return m;
+}
+
+void report(const bench_tree_t& tree, const std::string& op, const measurement_t& m)
+{
+    std::printf("%-8s %-16s %12.1f %12.2f %12.2f\n", tree.name.c_str(), op.c_str(),
+        1.0 * m.ns / m.ops, 1.0 * m.allocations / m.ops, 1.0 * m.tx_objects / m.ops);
+}
+
+/** A deterministic sequence of points inside the root */
+wf::point_t nth_point(int i)
+{
+    uint32_t x = 1103515245u * (i + 1) + 12345u;
+    uint32_t y = 1103515245u * x + 12345u;
+    return {(int)(x % root_geometry.width), (int)(y % root_geometry.height)};
+}
+
+/** Adjust the boundary between two adjacent siblings, like a resize does */
+void resize_pair(nonstd::observer_ptr<tree_node_t> first,
+    nonstd::observer_ptr<tree_node_t> second, bool horizontal, int delta)
+{
+    auto g1 = first->geometry;
+    auto g2 = second->geometry;
+    if (horizontal)
+    {
+        g1.height += delta;
+        g2.y += delta;
+        g2.height -= delta;
+    } else
+    {
+        g1.width += delta;
+        g2.x += delta;
+        g2.width -= delta;
+    }
+
+    first->set_geometry(g1);
+    second->set_geometry(g2);
+}
+
+void run(bench_tree_t tree, int ops)
+{
+    measurement_t ignored;
+    layout(tree, ignored);
+
+    auto target = tree.target;
+    int insert_at = target->get_children().size() / 2;
+
+    report(tree, "add_child", measure(ops, [&] (int, measurement_t& m)
+    {
+        target->add_child(headless::create_view_node(), insert_at);
+        layout(tree, m);
+    }));
+
+    report(tree, "remove_child", measure(ops, [&] (int, measurement_t& m)
+    {
+        target->remove_child(target->get_child(insert_at));
+        layout(tree, m);
+    }));
+
+    report(tree, "set_geometry", measure(ops, [&] (int i, measurement_t& m)
+    {
+        auto g = root_geometry;
+        g.width -= (i % 2) * 100;
+        tree.root->set_geometry(g);
+        layout(tree, m);
+    }));
+
+    report(tree, "set_gaps", measure(ops, [&] (int i, measurement_t& m)
+    {
+        int32_t size = 4 + (i % 2) * 4;
+        tree.root->set_gaps({size, size, size, size, size});
+        layout(tree, m);
+    }));
+
+    report(tree, "flatten_tree", measure(ops, [&] (int, measurement_t& m)
+    {
+        flatten_tree(tree.root);
+        layout(tree, m);
+    }));
+
+    report(tree, "find_view_at", measure(ops * 10, [&] (int i, measurement_t&)
+    {
+        find_view_at(tree.root, nth_point(i));
+    }));
+
+    /* Keyboard focus navigation, from views spread over the tree */
+    std::vector<nonstd::observer_ptr<view_node_t>> views;
+    for (int i = 0; i < 64; i++)
+    {
+        if (auto view = find_view_at(tree.root, nth_point(i)))
+        {
+            views.push_back(view);
+        }
+    }
+
+    const split_insertion_t directions[] = {
+        INSERT_LEFT, INSERT_RIGHT, INSERT_ABOVE, INSERT_BELOW
+    };
+    report(tree, "find_adjacent", measure(ops * 10, [&] (int i, measurement_t&)
+    {
+        find_adjacent(views[i % views.size()], directions[i % 4]);
+    }));
+
+    /* The work of resize_view_controller_t when a grab starts */
+    report(tree, "resize_grab", measure(ops * 10, [&] (int i, measurement_t&)
+    {
+        auto& view = views[i % views.size()];
+        find_resizing_pair(view, (i & 1) ? INSERT_ABOVE : INSERT_BELOW);
+        find_resizing_pair(view, (i & 2) ? INSERT_LEFT : INSERT_RIGHT);
+    }));
+
+    /* The same when the tree was resized since the last grab, which is the
+     * common case: cached pairs are checked against the new geometries, and
+     * the pairs which changed are searched again */
+    auto first_child  = target->get_child(0);
+    auto second_child = target->get_child(1);
+    bool target_horizontal = target->get_split_direction() == SPLIT_HORIZONTAL;
+    report(tree, "resize_regrab", measure(ops * 10, [&] (int i, measurement_t&)
+    {
+        resize_pair(first_child, second_child, target_horizontal,
+            (i % 2) ? -5 : 5);
+        auto& view = views[i % views.size()];
+        find_resizing_pair(view, (i & 1) ? INSERT_ABOVE : INSERT_BELOW);
+        find_resizing_pair(view, (i & 2) ? INSERT_LEFT : INSERT_RIGHT);
+    }));
+
+    /* The work of move_view_controller_t on each motion event */
+    report(tree, "move_motion", measure(ops * 10, [&] (int i, measurement_t&)
+    {
+        auto point = nth_point(i);
+        if (auto view = find_view_at(tree.root, point))
+        {
+            calculate_split_preview(view, calculate_insert_type(view, point));
+        }
+    }));
+
+    /* The work of resize_view_controller_t on each motion event, after the
+     * resizing pair was found on grab */
+    auto first  = target->get_child(0);
+    auto second = target->get_child(1);
+    bool horizontal = target->get_split_direction() == SPLIT_HORIZONTAL;
+    report(tree, "resize_motion", measure(ops, [&] (int i, measurement_t& m)
+    {
+        resize_pair(first, second, horizontal, (i % 2) ? -5 : 5);
+        layout(tree, m);
+    }));
+
+    /* The same in preview mode, where views are only configured on release */
+    report(tree, "resize_preview", measure(ops, [&] (int i, measurement_t&)
+    {
+        resize_pair(first, second, horizontal, (i % 2) ? -5 : 5);
+        preview_layout(tree.root);
+    }));
+    layout(tree, ignored);
+}
+}
+
+int main(int argc, char **argv)
+{
+    int ops = (argc > 1) ? std::atoi(argv[1]) : 1000;
+    if (ops <= 0)
+    {
+        std::fprintf(stderr, "usage: %s [operations]\n", argv[0]);
+        return 1;
+    }
+
+    std::printf("%-8s %-16s %12s %12s %12s\n",
+        "tree", "operation", "ns/op", "allocs/op", "tx objs/op");
+    run(make_wide(), ops);
+    run(make_deep(), ops);
+    run(make_mixed(), ops);
+
+    return 0;
+}
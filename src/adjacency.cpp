@@ -0,0 +1,65 @@
+#include "adjacency.hpp"
+#include "tree.hpp"
+
+namespace wf
+{
+namespace tile
+{
+void adjacency_graph_t::build(const tree_arena_t& arena)
+{
+    generation = arena.topology_generation;
+    links.assign(arena.slots.size(), node_links_t{});
+
+    /* Parents are filled in before their children by walking each tree in
+     * depth-first order, starting from the slots without parent. */
+    for (int32_t root = 0; root < (int32_t)arena.slots.size(); root++)
+    {
+        if (!arena.slots[root].node || (arena.slots[root].parent != tree_arena_t::NIL))
+        {
+            continue;
+        }
+
+        for (int32_t idx = root; idx != tree_arena_t::NIL;)
+        {
+            auto& slot = arena.slots[idx];
+            if ((slot.kind == NODE_SPLIT) && (slot.first_child != tree_arena_t::NIL))
+            {
+                auto split = static_cast<split_node_t*>(slot.node);
+                /* Vertical splits arrange their children from left to right */
+                int axis = (split->get_split_direction() == SPLIT_VERTICAL) ? 0 : 1;
+
+                int32_t index = 0;
+                for (int32_t child = slot.first_child; child != tree_arena_t::NIL;
+                     child = arena.slots[child].next_sibling, index++)
+                {
+                    auto& l = links[child];
+                    l = links[idx];
+                    l.ancestor[axis] = {idx, index};
+
+                    if (arena.slots[child].prev_sibling != tree_arena_t::NIL)
+                    {
+                        l.neighbour[2 * axis] = {idx, index - 1};
+                    }
+
+                    if (arena.slots[child].next_sibling != tree_arena_t::NIL)
+                    {
+                        l.neighbour[2 * axis + 1] = {idx, index + 1};
+                    }
+                }
+
+                idx = slot.first_child;
+                continue;
+            }
+
+            /* Advance to the next node in depth-first order */
+            while ((idx != root) && (arena.slots[idx].next_sibling == tree_arena_t::NIL))
+            {
+                idx = arena.slots[idx].parent;
+            }
+
+            idx = (idx == root) ? tree_arena_t::NIL : arena.slots[idx].next_sibling;
+        }
+    }
+}
+}
+}
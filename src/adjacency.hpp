@@ -0,0 +1,76 @@
+#ifndef WF_TILE_PLUGIN_ADJACENCY_HPP
+#define WF_TILE_PLUGIN_ADJACENCY_HPP
+
+#include <cstdint>
+#include <vector>
+
+namespace wf
+{
+namespace tile
+{
+struct tree_arena_t;
+
+/**
+ * The neighbours of every node of a tree in the four directions, so that
+ * keyboard navigation does not need to climb the tree.
+ *
+ * A link is a position in a split: the split and the index of a child in it.
+ * The neighbour of a node in a direction is the closest sibling in that
+ * direction, of the node itself or of the first ancestor which has one.
+ */
+class adjacency_graph_t
+{
+  public:
+    /** The directions, in the order of the split axes */
+    enum direction_t
+    {
+        LEFT  = 0,
+        RIGHT = 1,
+        ABOVE = 2,
+        BELOW = 3,
+    };
+
+    struct link_t
+    {
+        /** Slot of the split, NIL if there is no link */
+        int32_t split = -1;
+        /** Index of the child in the split */
+        int32_t index = -1;
+    };
+
+    /** The topology generation of the arena the graph was built at */
+    uint64_t generation = UINT64_MAX;
+
+    /** Rebuild the graph for all trees in the arena */
+    void build(const tree_arena_t& arena);
+
+    /** The neighbour of the node in the slot in the given direction */
+    link_t neighbour(int32_t slot, direction_t direction) const
+    {
+        return links[slot].neighbour[direction];
+    }
+
+    /**
+     * The closest ancestor of the node in the slot which splits along the
+     * axis of the direction, and the index of the child leading to the node.
+     */
+    link_t split_ancestor(int32_t slot, direction_t direction) const
+    {
+        return links[slot].ancestor[direction / 2];
+    }
+
+  private:
+    struct node_links_t
+    {
+        link_t neighbour[4];
+        /* Indexed by direction / 2 */
+        link_t ancestor[2];
+    };
+
+    /* Indexed by slot */
+    std::vector<node_links_t> links;
+};
+}
+}
+
+#endif /* end of include guard: WF_TILE_PLUGIN_ADJACENCY_HPP */
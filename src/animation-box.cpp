@@ -0,0 +1,32 @@
+#include "animation-box.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace wf
+{
+namespace tile
+{
+double animation_progress(double t)
+{
+    t = std::clamp(t, 0.0, 1.0);
+    return std::sqrt(t * (2.0 - t));
+}
+
+wf::geometry_t animation_box(wf::geometry_t start, wf::geometry_t end, double t)
+{
+    double progress = animation_progress(t);
+    auto lerp = [=] (int32_t a, int32_t b)
+    {
+        return (int32_t)std::round(a + (b - a) * progress);
+    };
+
+    return {
+        lerp(start.x, end.x),
+        lerp(start.y, end.y),
+        lerp(start.width, end.width),
+        lerp(start.height, end.height),
+    };
+}
+}
+}
@@ -0,0 +1,24 @@
+#ifndef WF_TILE_PLUGIN_ANIMATION_BOX_HPP
+#define WF_TILE_PLUGIN_ANIMATION_BOX_HPP
+
+#include <wayfire/geometry.hpp>
+
+namespace wf
+{
+namespace tile
+{
+/**
+ * The progress of a tile animation at time t, from 0.0 to 1.0, with the
+ * circle smoothing which is the default of wayfire animations.
+ */
+double animation_progress(double t);
+
+/**
+ * The box in which an animated view is shown at time t, between its start
+ * and end geometry. Each coordinate is rounded to the closest pixel.
+ */
+wf::geometry_t animation_box(wf::geometry_t start, wf::geometry_t end, double t);
+}
+}
+
+#endif /* end of include guard: WF_TILE_PLUGIN_ANIMATION_BOX_HPP */
@@ -0,0 +1,42 @@
+#include <wayfire/geometry.hpp>
+
+/*
+ * The geometry operators are implemented by the compositor itself. Headless
+ * builds do not link against it, so provide the same definitions here.
+ */
+bool operator ==(const wf::point_t& a, const wf::point_t& b)
+{
+    return a.x == b.x && a.y == b.y;
+}
+
+bool operator !=(const wf::point_t& a, const wf::point_t& b)
+{
+    return !(a == b);
+}
+
+bool operator ==(const wf::geometry_t& a, const wf::geometry_t& b)
+{
+    return a.x == b.x && a.y == b.y && a.width == b.width && a.height == b.height;
+}
+
+bool operator !=(const wf::geometry_t& a, const wf::geometry_t& b)
+{
+    return !(a == b);
+}
+
+bool operator &(const wf::geometry_t& rect, const wf::point_t& point)
+{
+    return point.x >= rect.x && point.x < rect.x + rect.width &&
+           point.y >= rect.y && point.y < rect.y + rect.height;
+}
+
+bool operator &(const wf::geometry_t& r1, const wf::geometry_t& r2)
+{
+    if ((r1.x + r1.width <= r2.x) || (r2.x + r2.width <= r1.x) ||
+        (r1.y + r1.height <= r2.y) || (r2.y + r2.height <= r1.y))
+    {
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,68 @@
+#include "headless-view.hpp"
+
+namespace wf
+{
+namespace tile
+{
+namespace headless
+{
+void headless_transaction_t::apply()
+{
+    for (auto& configure : configures)
+    {
+        configure.view->current = configure.geometry;
+    }
+
+    configures.clear();
+}
+
+bool headless_view_t::is_mapped()
+{
+    return mapped;
+}
+
+wf::geometry_t headless_view_t::calculate_target_geometry(
+    wf::geometry_t geometry, const gap_size_t& gaps)
+{
+    if (fullscreen)
+    {
+        return output;
+    }
+
+    geometry.x     += gaps.left;
+    geometry.y     += gaps.top;
+    geometry.width -= gaps.left + gaps.right;
+    geometry.height -= gaps.top + gaps.bottom;
+    return geometry;
+}
+
+bool headless_view_t::has_pending_geometry(wf::geometry_t target)
+{
+    return pending == target;
+}
+
+void headless_view_t::configure(wf::geometry_t target, layout_transaction_t& tx)
+{
+    pending = target;
+    static_cast<headless_transaction_t&>(tx).configures.push_back(
+        {nonstd::make_observer(this), target});
+}
+
+void headless_view_t::preview(wf::geometry_t target)
+{
+    previewed = target;
+}
+
+std::unique_ptr<view_node_t> create_view_node()
+{
+    return std::make_unique<view_node_t>(std::make_unique<headless_view_t>());
+}
+
+nonstd::observer_ptr<headless_view_t> get_headless_view(
+    nonstd::observer_ptr<view_node_t> node)
+{
+    return nonstd::make_observer(static_cast<headless_view_t*>(node->view.get()));
+}
+}
+}
+}
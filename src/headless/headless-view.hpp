@@ -0,0 +1,73 @@
+#ifndef WF_TILE_PLUGIN_HEADLESS_VIEW_HPP
+#define WF_TILE_PLUGIN_HEADLESS_VIEW_HPP
+
+#include <vector>
+#include "../tree.hpp"
+
+/*
+ * A headless backend for the tiling tree, which runs without a compositor.
+ * Views are configured instantly when the transaction is applied, which makes
+ * it possible to drive the layout code from benchmarks and tools.
+ */
+namespace wf
+{
+namespace tile
+{
+namespace headless
+{
+/**
+ * A layout transaction which records the configures of the layout pass.
+ */
+class headless_transaction_t : public layout_transaction_t
+{
+  public:
+    struct configure_t
+    {
+        nonstd::observer_ptr<class headless_view_t> view;
+        wf::geometry_t geometry;
+    };
+
+    /** The configures in the order in which they were made */
+    std::vector<configure_t> configures;
+
+    /** Make all configured views take their new geometry */
+    void apply();
+};
+
+/**
+ * A view which acks every configure as soon as its transaction is applied.
+ */
+class headless_view_t : public tiled_view_t
+{
+  public:
+    /** The geometry the view was last configured with */
+    wf::geometry_t pending = {0, 0, 0, 0};
+    /** The geometry the view has after the last applied transaction */
+    wf::geometry_t current = {0, 0, 0, 0};
+    /** The geometry the view was last previewed at */
+    wf::geometry_t previewed = {0, 0, 0, 0};
+
+    bool mapped = true;
+    bool fullscreen = false;
+    /** The output size used for fullscreen views */
+    wf::geometry_t output = {0, 0, 1920, 1080};
+
+    bool is_mapped() override;
+    wf::geometry_t calculate_target_geometry(
+        wf::geometry_t node_geometry, const gap_size_t& gaps) override;
+    bool has_pending_geometry(wf::geometry_t target) override;
+    void configure(wf::geometry_t target, layout_transaction_t& tx) override;
+    void preview(wf::geometry_t target) override;
+};
+
+/** Create a view node containing a new headless view */
+std::unique_ptr<view_node_t> create_view_node();
+
+/** Get the headless view of a view node */
+nonstd::observer_ptr<headless_view_t> get_headless_view(
+    nonstd::observer_ptr<view_node_t> node);
+}
+}
+}
+
+#endif /* end of include guard: WF_TILE_PLUGIN_HEADLESS_VIEW_HPP */
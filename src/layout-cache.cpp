@@ -0,0 +1,154 @@
+#include "layout-cache.hpp"
+#include "tree.hpp"
+#include "tile-stats.hpp"
+
+#include <algorithm>
+
+namespace wf
+{
+namespace tile
+{
+bool layout_cache_t::key_t::operator ==(const key_t& other) const
+{
+    return (shape == other.shape) && (geometry == other.geometry) &&
+           (gaps.left == other.gaps.left) && (gaps.right == other.gaps.right) &&
+           (gaps.top == other.gaps.top) && (gaps.bottom == other.gaps.bottom) &&
+           (gaps.internal == other.gaps.internal);
+}
+
+/** Call fn for each descendant of the slot root, in depth-first order */
+template<class Fn>
+static void for_each_descendant(const tree_arena_t& arena, int32_t root, Fn fn)
+{
+    int32_t idx = arena.slots[root].first_child;
+    while (idx != tree_arena_t::NIL)
+    {
+        fn(idx);
+
+        if (arena.slots[idx].first_child != tree_arena_t::NIL)
+        {
+            idx = arena.slots[idx].first_child;
+            continue;
+        }
+
+        /* Go up until there is a next sibling, stopping at the root */
+        while ((idx != root) && (arena.slots[idx].next_sibling == tree_arena_t::NIL))
+        {
+            idx = arena.slots[idx].parent;
+        }
+
+        idx = (idx == root) ? tree_arena_t::NIL : arena.slots[idx].next_sibling;
+    }
+}
+
+layout_cache_t::key_t layout_cache_t::make_key(tree_node_t *root)
+{
+    key_t key;
+    key.shape    = root->arena->shape_hash;
+    key.geometry = root->geometry;
+    key.gaps     = root->get_gaps();
+    return key;
+}
+
+void layout_cache_t::store(tree_node_t *root, const key_t& key)
+{
+    auto it = std::find_if(entries.begin(), entries.end(),
+        [&] (const entry_t& e) { return e.key == key; });
+
+    if (it == entries.end())
+    {
+        if (entries.size() < MAX_ENTRIES)
+        {
+            entries.emplace_back();
+            it = entries.end() - 1;
+        } else
+        {
+            it = std::min_element(entries.begin(), entries.end(),
+                [] (const entry_t& a, const entry_t& b)
+            {
+                return a.last_use < b.last_use;
+            });
+        }
+    }
+
+    auto& arena = *root->arena;
+    it->key = key;
+    it->last_use = ++use_counter;
+    it->nodes.clear();
+    for_each_descendant(arena, root->slot, [&] (int32_t idx)
+    {
+        auto node = arena.slots[idx].node;
+        it->nodes.push_back({node, node->geometry, node->get_gaps()});
+    });
+}
+
+bool layout_cache_t::restore(tree_node_t *root)
+{
+    auto& arena = *root->arena;
+    auto key = make_key(root);
+
+    /* The entries are only valid for the same set of nodes. Forgetting them
+     * here keeps adding and removing views cheap. */
+    if (!has_last || (arena.link_generation != link_generation))
+    {
+        entries.clear();
+        last = key;
+        has_last = true;
+        last_stored     = false;
+        link_generation = arena.link_generation;
+        edit_generation = arena.edit_generation;
+        return false;
+    }
+
+    if (key == last)
+    {
+        return false;
+    }
+
+    if (arena.edit_generation != edit_generation)
+    {
+        /* Nodes were resized since the last layout was entered, so the other
+         * remembered layouts no longer follow from it */
+        entries.clear();
+        last_stored     = false;
+        edit_generation = arena.edit_generation;
+    }
+
+    /* The descendants still have the geometries of the last layout */
+    if (!last_stored)
+    {
+        store(root, last);
+    }
+
+    last = key;
+    auto it = std::find_if(entries.begin(), entries.end(),
+        [&] (const entry_t& e) { return e.key == key; });
+    if (it == entries.end())
+    {
+        last_stored = false;
+        return false;
+    }
+
+    it->last_use = ++use_counter;
+    arena.in_layout = true;
+    for (auto& state : it->nodes)
+    {
+        state.node->set_gaps(state.gaps);
+        state.node->set_geometry(state.geometry);
+
+        /* The children of all splits are restored, they must not be rescaled */
+        if (state.node->kind == NODE_SPLIT)
+        {
+            arena.slots[state.node->slot].flags &= ~tree_arena_t::LAYOUT_DIRTY;
+        }
+    }
+
+    arena.in_layout = false;
+    arena.slots[root->slot].flags &= ~tree_arena_t::LAYOUT_DIRTY;
+
+    last_stored = true;
+    get_stats().layouts_restored++;
+    return true;
+}
+}
+}
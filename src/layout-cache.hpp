@@ -0,0 +1,88 @@
+#ifndef WF_TILE_PLUGIN_LAYOUT_CACHE_HPP
+#define WF_TILE_PLUGIN_LAYOUT_CACHE_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "tiled-view.hpp"
+
+namespace wf
+{
+namespace tile
+{
+struct tree_node_t;
+
+/**
+ * The geometries of a tree in the layouts it had recently. Returning to one
+ * of them, e.g. when a panel is shown again or a split direction is toggled
+ * back, restores exactly the earlier geometries, instead of rescaling the
+ * current ones and accumulating rounding errors.
+ *
+ * A layout is identified by the directions and tabbed states of the splits,
+ * the geometry of the root and its gaps. Layouts are only remembered while
+ * the same nodes are in the tree and all geometries were derived by the
+ * layout pass: adding or removing a node, or resizing one directly, for
+ * example with the resize controller, forgets the earlier layouts.
+ */
+class layout_cache_t
+{
+  public:
+    /** Maximum number of remembered layouts */
+    static constexpr size_t MAX_ENTRIES = 8;
+
+    /**
+     * Called before the tree of root is laid out. If the tree is in a
+     * different layout than the last time, the current geometries are
+     * remembered for the last layout, and the geometries of the new layout
+     * are restored if it is known.
+     *
+     * @return Whether the geometries were restored
+     */
+    bool restore(tree_node_t *root);
+
+  private:
+    struct key_t
+    {
+        uint64_t shape = 0;
+        wf::geometry_t geometry = {0, 0, 0, 0};
+        gap_size_t gaps;
+
+        bool operator ==(const key_t& other) const;
+    };
+
+    struct node_state_t
+    {
+        tree_node_t *node;
+        wf::geometry_t geometry;
+        gap_size_t gaps;
+    };
+
+    struct entry_t
+    {
+        key_t key;
+        /** All nodes except for the root, in depth-first order */
+        std::vector<node_state_t> nodes;
+        uint64_t last_use = 0;
+    };
+
+    std::vector<entry_t> entries;
+    uint64_t use_counter = 0;
+
+    /** The layout the tree was last laid out in */
+    key_t last;
+    bool has_last = false;
+    /** Whether the geometries of the last layout are in the entries */
+    bool last_stored = false;
+
+    /** The link and edit generations of the arena the entries are valid for */
+    uint64_t link_generation = 0;
+    uint64_t edit_generation = 0;
+
+    static key_t make_key(tree_node_t *root);
+    /** Remember the current geometries of the tree for the given layout */
+    void store(tree_node_t *root, const key_t& key);
+};
+}
+}
+
+#endif /* end of include guard: WF_TILE_PLUGIN_LAYOUT_CACHE_HPP */
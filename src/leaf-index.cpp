@@ -0,0 +1,142 @@
+#include "leaf-index.hpp"
+#include "tree.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace wf
+{
+namespace tile
+{
+/* Upper bound for the number of buckets in each direction */
+static constexpr int32_t MAX_BUCKETS = 128;
+
+static bool contains(const wf::geometry_t& g, const wf::point_t& p)
+{
+    return p.x >= g.x && p.x < g.x + g.width &&
+           p.y >= g.y && p.y < g.y + g.height;
+}
+
+void leaf_index_t::bucket_range(wf::geometry_t g, int32_t& x1, int32_t& y1,
+    int32_t& x2, int32_t& y2) const
+{
+    x1 = std::clamp((g.x - bounds.x) / cell_width, 0, columns - 1);
+    y1 = std::clamp((g.y - bounds.y) / cell_height, 0, rows - 1);
+    x2 = std::clamp((g.x + g.width - 1 - bounds.x) / cell_width, 0, columns - 1);
+    y2 = std::clamp((g.y + g.height - 1 - bounds.y) / cell_height, 0, rows - 1);
+}
+
+void leaf_index_t::build(tree_node_t *root)
+{
+    generation = root->arena ? root->arena->generation : 0;
+    bounds = root->geometry;
+    leaves.clear();
+    entries.clear();
+    columns = rows = 0;
+
+    /* Collect the leaves in tree order */
+    int64_t sum_width = 0, sum_height = 0;
+    auto& arena = *root->arena;
+    for (int32_t idx = root->slot; idx != tree_arena_t::NIL;)
+    {
+        auto& slot = arena.slots[idx];
+        if (slot.kind == NODE_VIEW)
+        {
+            auto g = slot.node->geometry;
+            if ((g.width > 0) && (g.height > 0))
+            {
+                leaves.push_back({g, static_cast<view_node_t*>(slot.node)});
+                sum_width  += g.width;
+                sum_height += g.height;
+            }
+        }
+
+        /* Advance to the next node in depth-first order */
+        if ((slot.kind == NODE_SPLIT) && (slot.first_child != tree_arena_t::NIL))
+        {
+            idx = slot.first_child;
+            continue;
+        }
+
+        while ((idx != root->slot) && (arena.slots[idx].next_sibling == tree_arena_t::NIL))
+        {
+            idx = arena.slots[idx].parent;
+        }
+
+        idx = (idx == root->slot) ? tree_arena_t::NIL : arena.slots[idx].next_sibling;
+    }
+
+    if (leaves.empty() || (bounds.width <= 0) || (bounds.height <= 0))
+    {
+        return;
+    }
+
+    /* Aim for as many buckets in each direction as leaves fit next to each
+     * other on average. */
+    int64_t n = leaves.size();
+    columns = std::clamp<int64_t>(std::llround(1.0 * bounds.width * n / sum_width), 1, MAX_BUCKETS);
+    rows    = std::clamp<int64_t>(std::llround(1.0 * bounds.height * n / sum_height), 1, MAX_BUCKETS);
+    cell_width  = (bounds.width + columns - 1) / columns;
+    cell_height = (bounds.height + rows - 1) / rows;
+
+    /* Count the entries of each bucket, and turn the counts into the end of
+     * each bucket */
+    bucket_start.assign(columns * rows + 1, 0);
+    for (auto& leaf : leaves)
+    {
+        int32_t x1, y1, x2, y2;
+        bucket_range(leaf.geometry, x1, y1, x2, y2);
+        for (int32_t y = y1; y <= y2; y++)
+        {
+            for (int32_t x = x1; x <= x2; x++)
+            {
+                ++bucket_start[y * columns + x];
+            }
+        }
+    }
+
+    uint32_t total = 0;
+    for (auto& start : bucket_start)
+    {
+        total += start;
+        start  = total;
+    }
+
+    /* Fill the buckets from the back, so that each ends up in tree order and
+     * bucket_start ends up at the start of each bucket */
+    entries.resize(total);
+    for (auto it = leaves.rbegin(); it != leaves.rend(); ++it)
+    {
+        int32_t x1, y1, x2, y2;
+        bucket_range(it->geometry, x1, y1, x2, y2);
+        for (int32_t y = y1; y <= y2; y++)
+        {
+            for (int32_t x = x1; x <= x2; x++)
+            {
+                entries[--bucket_start[y * columns + x]] = *it;
+            }
+        }
+    }
+}
+
+view_node_t *leaf_index_t::find(wf::point_t point) const
+{
+    if ((columns == 0) || !contains(bounds, point))
+    {
+        return nullptr;
+    }
+
+    int32_t bucket = ((point.y - bounds.y) / cell_height) * columns +
+        (point.x - bounds.x) / cell_width;
+    for (uint32_t i = bucket_start[bucket]; i < bucket_start[bucket + 1]; i++)
+    {
+        if (contains(entries[i].geometry, point))
+        {
+            return entries[i].node;
+        }
+    }
+
+    return nullptr;
+}
+}
+}
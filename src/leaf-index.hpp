@@ -0,0 +1,67 @@
+#ifndef WF_TILE_PLUGIN_LEAF_INDEX_HPP
+#define WF_TILE_PLUGIN_LEAF_INDEX_HPP
+
+#include <cstdint>
+#include <vector>
+#include <wayfire/geometry.hpp>
+
+namespace wf
+{
+namespace tile
+{
+struct tree_node_t;
+struct view_node_t;
+
+/**
+ * A spatial index of the leaves of a laid out tree, for hit-testing without
+ * walking the tree.
+ *
+ * The area of the root is divided in a grid of buckets, each of which lists
+ * the leaves overlapping it in tree order. The grid is sized from the average
+ * leaf size, so that a bucket usually holds only a handful of leaves.
+ */
+class leaf_index_t
+{
+  public:
+    /** The generation of the arena the index was built at */
+    uint64_t generation = UINT64_MAX;
+
+    /**
+     * Rebuild the index from the current geometry of the tree, and mark it as
+     * up to date with the arena of the tree.
+     */
+    void build(tree_node_t *root);
+
+    /**
+     * Find the first leaf in tree order which contains the point, or nullptr
+     * if there is none.
+     */
+    view_node_t *find(wf::point_t point) const;
+
+  private:
+    struct entry_t
+    {
+        wf::geometry_t geometry;
+        view_node_t *node;
+    };
+
+    wf::geometry_t bounds = {0, 0, 0, 0};
+    int32_t columns = 0;
+    int32_t rows    = 0;
+    int32_t cell_width  = 1;
+    int32_t cell_height = 1;
+
+    /** The leaves of the tree, in tree order */
+    std::vector<entry_t> leaves;
+    /** Entries of bucket i are entries[bucket_start[i]..bucket_start[i+1]) */
+    std::vector<uint32_t> bucket_start;
+    std::vector<entry_t> entries;
+
+    /** Calculate the range of buckets a geometry overlaps */
+    void bucket_range(wf::geometry_t g, int32_t& x1, int32_t& y1,
+        int32_t& x2, int32_t& y2) const;
+};
+}
+}
+
+#endif /* end of include guard: WF_TILE_PLUGIN_LEAF_INDEX_HPP */
@@ -0,0 +1,69 @@
+#include "pair-resize.hpp"
+
+#include <algorithm>
+
+namespace wf
+{
+namespace tile
+{
+pair_resize_t::pair_resize_t(resizing_pair_t horizontal,
+    resizing_pair_t vertical, wf::point_t grab) :
+    horizontal_pair(horizontal), vertical_pair(vertical), last_point(grab)
+{}
+
+void pair_resize_t::adjust_geometry(int32_t& len1, int32_t& x2, int32_t& len2,
+    int32_t delta)
+{
+    int maxPositive = std::max(0, len2 - MIN_SIZE);
+    int maxNegative = std::max(0, len1 - MIN_SIZE);
+
+    /* Make sure we don't shrink one dimension too much */
+    delta = std::clamp(delta, -maxNegative, maxPositive);
+
+    /* Adjust sizes */
+    len1 += delta;
+    x2   += delta;
+    len2 -= delta;
+}
+
+void pair_resize_t::move(wf::point_t input)
+{
+    if (horizontal_pair.first && horizontal_pair.second)
+    {
+        auto g1 = horizontal_pair.first->geometry;
+        auto g2 = horizontal_pair.second->geometry;
+
+        adjust_geometry(g1.height, g2.y, g2.height, input.y - last_point.y);
+        horizontal_pair.first->set_geometry(g1);
+        horizontal_pair.second->set_geometry(g2);
+    }
+
+    if (vertical_pair.first && vertical_pair.second)
+    {
+        auto g1 = vertical_pair.first->geometry;
+        auto g2 = vertical_pair.second->geometry;
+
+        adjust_geometry(g1.width, g2.x, g2.width, input.x - last_point.x);
+        vertical_pair.first->set_geometry(g1);
+        vertical_pair.second->set_geometry(g2);
+    }
+
+    last_point = input;
+}
+
+void pair_resize_t::preview(nonstd::observer_ptr<tree_node_t> root)
+{
+    preview_layout(root);
+    previewed = true;
+}
+
+void pair_resize_t::commit(nonstd::observer_ptr<tree_node_t> root,
+    layout_transaction_t& tx)
+{
+    /* Both pairs are laid out in one pass, so views shared by them are only
+     * configured once. */
+    layout_tree(root, tx);
+    previewed = false;
+}
+}
+}
@@ -0,0 +1,67 @@
+#ifndef WF_TILE_PLUGIN_PAIR_RESIZE_HPP
+#define WF_TILE_PLUGIN_PAIR_RESIZE_HPP
+
+#include "tree-search.hpp"
+
+namespace wf
+{
+namespace tile
+{
+/**
+ * The common edges moved by a drag-resize: a horizontally and a vertically
+ * aligned resizing pair, whose boundary follows the input.
+ *
+ * The moved geometries can be previewed on the views while dragging. They
+ * must be committed before the resize ends, also when it is stopped without
+ * a release, because otherwise the nodes keep geometries which the views
+ * were never configured with.
+ */
+class pair_resize_t
+{
+  public:
+    /** The smallest width or height a node of a pair is shrunk to */
+    static constexpr int32_t MIN_SIZE = 50;
+
+    pair_resize_t() = default;
+    pair_resize_t(resizing_pair_t horizontal, resizing_pair_t vertical,
+        wf::point_t grab);
+
+    /** The horizontally-aligned pair, whose common edge moves vertically */
+    resizing_pair_t horizontal_pair;
+    /** The vertically-aligned pair, whose common edge moves horizontally */
+    resizing_pair_t vertical_pair;
+
+    /** Move the common edges of the pairs by the motion since the last call */
+    void move(wf::point_t input);
+
+    /** Show the moved geometries on the views without configuring them */
+    void preview(nonstd::observer_ptr<tree_node_t> root);
+
+    /** Lay out the tree, configuring the views with the moved geometries */
+    void commit(nonstd::observer_ptr<tree_node_t> root, layout_transaction_t& tx);
+
+    /** Whether geometries were previewed which are not committed yet */
+    bool has_preview() const
+    {
+        return previewed;
+    }
+
+  private:
+    /** Input location of the last move */
+    wf::point_t last_point = {0, 0};
+    bool previewed = false;
+
+    /**
+     * Move the common edge of two adjacent ranges on one axis by delta,
+     * keeping both at least MIN_SIZE long if they were.
+     *
+     * x1        (x1+len1)=x2         x2+len2-1
+     * ._______________.___________________.
+     */
+    static void adjust_geometry(int32_t& len1, int32_t& x2, int32_t& len2,
+        int32_t delta);
+};
+}
+}
+
+#endif /* end of include guard: WF_TILE_PLUGIN_PAIR_RESIZE_HPP */
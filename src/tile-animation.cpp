@@ -0,0 +1,279 @@
+#include "tile-animation.hpp"
+#include "wayfire-view.hpp"
+#include "tile-stats.hpp"
+#include "animation-box.hpp"
+
+#include <wayfire/util.hpp>
+
+namespace wf
+{
+namespace tile
+{
+animation_scheduler_t::animation_scheduler_t(wf::output_t *output)
+{
+    this->output = output;
+    output->connect_signal("view-disappeared", &on_view_disappeared);
+}
+
+animation_scheduler_t::~animation_scheduler_t()
+{
+    while (!animations.empty())
+    {
+        finish(animations.size() - 1);
+    }
+
+    output->disconnect_signal(&on_view_disappeared);
+}
+
+nonstd::observer_ptr<animation_scheduler_t> animation_scheduler_t::get(
+    wf::output_t *output)
+{
+    if (!output || !output->has_data<animation_scheduler_t>())
+    {
+        return nullptr;
+    }
+
+    return output->get_data<animation_scheduler_t>();
+}
+
+bool animation_scheduler_t::can_crossfade()
+{
+    if ((limit > 0) && (crossfades >= limit))
+    {
+        get_stats().animations_over_limit++;
+        return false;
+    }
+
+    /* The frame time is only known while something animates */
+    if ((max_frame_time > 0) && !animations.empty() &&
+        (frame_time > max_frame_time))
+    {
+        get_stats().animations_slow_frames++;
+        return false;
+    }
+
+    return true;
+}
+
+bool animation_scheduler_t::is_visible(wayfire_toplevel_view view,
+    wf::geometry_t target)
+{
+    if ((view->get_wset() != output->wset()) || view->minimized)
+    {
+        return false;
+    }
+
+    /* Geometries are relative to the current workspace of the output */
+    auto screen = output->get_relative_geometry();
+    return (screen & view->get_geometry()) || (screen & target);
+}
+
+bool animation_scheduler_t::animate(wayfire_toplevel_view view,
+    wf::geometry_t target)
+{
+    if (inhibit_count > 0)
+    {
+        stop(view);
+        return false;
+    }
+
+    if (!is_visible(view, target))
+    {
+        get_stats().animations_offscreen++;
+        stop(view);
+        return false;
+    }
+
+    auto current = view->get_geometry();
+    if ((current.width <= 0) || (current.height <= 0))
+    {
+        stop(view);
+        return false;
+    }
+
+    auto it = index.find(view);
+    if (it == index.end())
+    {
+        get_stats().animations_started++;
+        bool crossfade = ((std::string)type == "crossfade") && can_crossfade();
+        crossfades += crossfade;
+        std::shared_ptr<wf::scene::view_2d_transformer_t> transformer;
+        if (crossfade)
+        {
+            view->get_transformed_node()->rem_transformer(scale_transformer_name);
+            transformer = std::make_shared<crossfade_node_t>(view, snapshots,
+                snapshot_scale);
+            view->get_transformed_node()->add_transformer(transformer,
+                wf::TRANSFORMER_2D);
+        } else
+        {
+            /* Slide from the box the view is shown in, which differs from
+             * its geometry after a preview */
+            auto scale = wf::ensure_named_transformer<scale_transformer_t>(view,
+                wf::TRANSFORMER_2D, scale_transformer_name, view, current);
+            current     = scale->box;
+            transformer = scale;
+        }
+
+        index[view] = animations.size();
+        animations.push_back({view, transformer, crossfade, current, target,
+            current, wf::get_current_time()});
+    } else
+    {
+        auto& anim = animations[it->second];
+        anim.start     = current;
+        anim.end       = target;
+        anim.committed = current;
+        anim.start_time = wf::get_current_time();
+    }
+
+    view->toplevel()->pending().geometry = target;
+
+    if (!hook_active)
+    {
+        output->render->add_effect(&on_frame, wf::OUTPUT_EFFECT_PRE);
+        hook_active = true;
+        last_step   = 0;
+    }
+
+    output->render->schedule_redraw();
+    return true;
+}
+
+bool animation_scheduler_t::is_animating(wayfire_toplevel_view view) const
+{
+    return index.count(view);
+}
+
+void animation_scheduler_t::stop(wayfire_toplevel_view view)
+{
+    auto it = index.find(view);
+    if (it != index.end())
+    {
+        finish(it->second);
+    }
+}
+
+void animation_scheduler_t::inhibit(bool inhibit)
+{
+    inhibit_count += inhibit ? 1 : -1;
+}
+
+void animation_scheduler_t::step()
+{
+    uint32_t now = wf::get_current_time();
+    int length   = duration;
+
+    if (last_step != 0)
+    {
+        double interval = now - last_step;
+        frame_time = (frame_time > 0) ? (0.75 * frame_time + 0.25 * interval) :
+            interval;
+    } else
+    {
+        frame_time = 0.0;
+    }
+
+    last_step = now;
+
+    size_t i = 0;
+    while (i < animations.size())
+    {
+        auto& anim = animations[i];
+        auto node  = anim.view->get_transformed_node();
+
+        double t = (length > 0) ? (now - anim.start_time) / (double)length : 1.0;
+        if (t >= 1.0)
+        {
+            /* Removing the transformer damages the view */
+            finish(i);
+            continue;
+        }
+
+        auto geometry = anim.view->get_geometry();
+        if ((geometry.width <= 0) || (geometry.height <= 0))
+        {
+            ++i;
+            continue;
+        }
+
+        if (geometry != anim.committed)
+        {
+            anim.committed = geometry;
+            anim.end = geometry;
+        }
+
+        auto box = animation_box(anim.start, anim.end, t);
+        if ((box.width <= 0) || (box.height <= 0))
+        {
+            ++i;
+            continue;
+        }
+
+        /* Damages the old and the new bounding box of the view */
+        node->begin_transform_update();
+        if (anim.crossfade)
+        {
+            auto crossfade =
+                std::static_pointer_cast<crossfade_node_t>(anim.transformer);
+            crossfade->scale_x = (double)box.width / geometry.width;
+            crossfade->scale_y = (double)box.height / geometry.height;
+            crossfade->translation_x = (box.x + box.width / 2.0) -
+                (geometry.x + geometry.width / 2.0);
+            crossfade->translation_y = (box.y + box.height / 2.0) -
+                (geometry.y + geometry.height / 2.0);
+            crossfade->displayed_geometry = box;
+            crossfade->overlay_alpha = animation_progress(t);
+        } else
+        {
+            std::static_pointer_cast<scale_transformer_t>(anim.transformer)->set_box(
+                box);
+        }
+
+        node->end_transform_update();
+        ++i;
+    }
+}
+
+void animation_scheduler_t::finish(size_t idx)
+{
+    auto anim = std::move(animations[idx]);
+    if (idx + 1 < animations.size())
+    {
+        animations[idx] = std::move(animations.back());
+        index[animations[idx].view] = idx;
+    }
+
+    animations.pop_back();
+    index.erase(anim.view);
+    crossfades -= anim.crossfade;
+
+    /* Reuse the framebuffer of the snapshot for the next crossfade */
+    if (anim.crossfade)
+    {
+        auto crossfade = std::static_pointer_cast<crossfade_node_t>(anim.transformer);
+        if (auto snapshot = crossfade->take_snapshot())
+        {
+            snapshots.release(std::move(snapshot));
+        }
+    }
+
+    /* The view is not animating anymore when its tiled view is notified, so
+     * that it can apply its scale transformer again. A slide leaves the
+     * scale transformer to the tiled view, which sets its final box. */
+    if (anim.crossfade)
+    {
+        anim.view->get_transformed_node()->rem_transformer(anim.transformer);
+    }
+
+    tile_adjust_transformer_signal ev;
+    anim.view->emit(&ev);
+
+    if (animations.empty() && hook_active)
+    {
+        output->render->rem_effect(&on_frame);
+        hook_active = false;
+    }
+}
+}
+}
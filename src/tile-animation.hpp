@@ -0,0 +1,147 @@
+#ifndef WF_TILE_PLUGIN_TILE_ANIMATION_HPP
+#define WF_TILE_PLUGIN_TILE_ANIMATION_HPP
+
+#include <unordered_map>
+#include <vector>
+
+#include <wayfire/output.hpp>
+#include <wayfire/view.hpp>
+#include <wayfire/option-wrapper.hpp>
+#include <wayfire/render-manager.hpp>
+#include <wayfire/signal-definitions.hpp>
+#include <wayfire/view-transform.hpp>
+
+#include "tile-crossfade.hpp"
+
+namespace wf
+{
+namespace tile
+{
+/**
+ * Animates the tiled views of an output towards their new geometry.
+ *
+ * Depending on the animation_type option, a view either crossfades from a
+ * snapshot of its old contents with a crossfade_node_t, whose snapshots come
+ * from a pool of the scheduler, or its current contents slide and scale from
+ * the old to the new geometry by moving the box of the scale_transformer_t of
+ * its tiled view, which needs no snapshot.
+ *
+ * All running animations are kept in one flat array, indexed by their view,
+ * and are stepped from a single pre-render hook, which is only installed
+ * while something animates.
+ *
+ * Crossfades are limited by a budget: only a number of views may crossfade
+ * at the same time, and no crossfades are started while the measured frame
+ * time is too high. Views over the budget slide instead, which needs no
+ * snapshot.
+ *
+ * The scheduler is created by the plugin instance of the output, and stored
+ * on the output so that the tiled views can find it.
+ */
+class animation_scheduler_t : public wf::custom_data_t
+{
+  public:
+    animation_scheduler_t(wf::output_t *output);
+    ~animation_scheduler_t();
+
+    /** Get the scheduler of the output, or nullptr if it has none */
+    static nonstd::observer_ptr<animation_scheduler_t> get(wf::output_t *output);
+
+    /**
+     * Start animating the view from its current geometry to target, which
+     * is set as its pending geometry. An animation which is already running
+     * for the view is restarted towards the new target.
+     *
+     * Views which can not be seen, because they are on another workspace or
+     * not on the output, are not animated, and their running animation is
+     * stopped.
+     *
+     * @return false if the view is not animated, in which case its pending
+     *   geometry is not touched
+     */
+    bool animate(wayfire_toplevel_view view, wf::geometry_t target);
+
+    /** Check whether the view is animating */
+    bool is_animating(wayfire_toplevel_view view) const;
+
+    /** Stop the animation of the view, if it has one */
+    void stop(wayfire_toplevel_view view);
+
+    /**
+     * Inhibit new animations, e.g. for the final commit of an interactive
+     * resize, whose views are already shown at their new size. Calls nest.
+     */
+    void inhibit(bool inhibit);
+
+    animation_scheduler_t(const animation_scheduler_t &) = delete;
+    animation_scheduler_t(animation_scheduler_t &&) = delete;
+    animation_scheduler_t& operator =(const animation_scheduler_t&) = delete;
+    animation_scheduler_t& operator =(animation_scheduler_t&&) = delete;
+
+  private:
+    struct animation_t
+    {
+        wayfire_toplevel_view view;
+        /** A crossfade_node_t if crossfade is set, otherwise the
+         * scale_transformer_t of the tiled view */
+        std::shared_ptr<wf::scene::view_2d_transformer_t> transformer;
+        bool crossfade;
+        /** The animated geometry at the start and at the end */
+        wf::geometry_t start, end;
+        /** The last view geometry seen, the end follows the view when the
+         * client commits a geometry which differs from the target */
+        wf::geometry_t committed;
+        /** Time at which the animation started, in milliseconds */
+        uint32_t start_time;
+    };
+
+    wf::output_t *output;
+    std::vector<animation_t> animations;
+    /** The index of the animation of each view in animations */
+    std::unordered_map<wayfire_toplevel_view, size_t> index;
+    wf::option_wrapper_t<int> duration{"better-tiling/animation_duration"};
+    wf::option_wrapper_t<std::string> type{"better-tiling/animation_type"};
+    wf::option_wrapper_t<int> limit{"better-tiling/animation_limit"};
+    wf::option_wrapper_t<int> max_frame_time{"better-tiling/animation_max_frame_time"};
+    wf::option_wrapper_t<double> snapshot_scale{"better-tiling/snapshot_scale"};
+
+    /** The framebuffers of the crossfade snapshots */
+    snapshot_pool_t snapshots;
+
+    /** Average time between the last frames while animating, in milliseconds */
+    double frame_time = 0.0;
+    /** Time of the last step, 0 if the previous frame had no animations */
+    uint32_t last_step = 0;
+
+    /** Check whether the view is visible now or at the target geometry */
+    bool is_visible(wayfire_toplevel_view view, wf::geometry_t target);
+
+    /** Check whether another crossfade fits in the budget, counting it if not */
+    bool can_crossfade();
+    /** Number of running animations which crossfade */
+    int crossfades = 0;
+
+    /** Number of active inhibit(true) calls */
+    int inhibit_count = 0;
+
+    bool hook_active = false;
+    wf::effect_hook_t on_frame = [=] () { step(); };
+
+    wf::signal_connection_t on_view_disappeared = [=] (wf::signal_data_t *data)
+    {
+        stop(toplevel_cast(get_signaled_view(data)));
+    };
+
+    /** Advance all animations to the current time */
+    void step();
+
+    /**
+     * Remove the animation at idx, moving the last animation in its place,
+     * and give the view back to its tiled view.
+     */
+    void finish(size_t idx);
+};
+}
+}
+
+#endif /* end of include guard: WF_TILE_PLUGIN_TILE_ANIMATION_HPP */
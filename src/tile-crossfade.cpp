@@ -0,0 +1,200 @@
+#include "tile-crossfade.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <wayfire/scene-render.hpp>
+
+namespace wf
+{
+namespace tile
+{
+snapshot_pool_t::~snapshot_pool_t()
+{
+    OpenGL::render_begin();
+    for (auto& buffer : idle)
+    {
+        buffer->release();
+    }
+
+    OpenGL::render_end();
+}
+
+std::unique_ptr<wf::render_target_t> snapshot_pool_t::acquire(int width,
+    int height)
+{
+    /* Prefer a framebuffer which does not need to be reallocated */
+    auto it = std::find_if(idle.begin(), idle.end(),
+        [&] (const std::unique_ptr<wf::render_target_t>& buffer)
+    {
+        return (buffer->viewport_width == width) &&
+               (buffer->viewport_height == height);
+    });
+    if ((it == idle.end()) && !idle.empty())
+    {
+        it = idle.end() - 1;
+    }
+
+    std::unique_ptr<wf::render_target_t> buffer;
+    if (it != idle.end())
+    {
+        buffer = std::move(*it);
+        idle.erase(it);
+    } else
+    {
+        buffer = std::make_unique<wf::render_target_t>();
+    }
+
+    OpenGL::render_begin();
+    buffer->allocate(width, height);
+    OpenGL::render_end();
+    return buffer;
+}
+
+void snapshot_pool_t::release(std::unique_ptr<wf::render_target_t> buffer)
+{
+    if (idle.size() < MAX_IDLE)
+    {
+        idle.push_back(std::move(buffer));
+        return;
+    }
+
+    OpenGL::render_begin();
+    buffer->release();
+    OpenGL::render_end();
+}
+
+/**
+ * Renders the snapshot of a crossfade_node_t on top of the view.
+ *
+ * The snapshot does not change, and the node damages its bounding box on
+ * each step of the animation, so no damage is tracked here.
+ */
+class crossfade_render_instance_t : public wf::scene::render_instance_t
+{
+  public:
+    crossfade_render_instance_t(crossfade_node_t *self)
+    {
+        this->self = self;
+    }
+
+    void schedule_instructions(
+        std::vector<wf::scene::render_instruction_t>& instructions,
+        const wf::render_target_t& target, wf::region_t& damage) override
+    {
+        if (!self->snapshot)
+        {
+            return;
+        }
+
+        instructions.push_back(wf::scene::render_instruction_t{
+            .instance = this,
+            .target   = target,
+            .damage   = damage & self->get_bounding_box(),
+        });
+    }
+
+    void render(const wf::render_target_t& target,
+        const wf::region_t& region) override
+    {
+        /* Fade out slowly at first, so that the view does not flicker */
+        double ra;
+        const double N = 2;
+        if (self->overlay_alpha < 0.5)
+        {
+            ra = std::pow(self->overlay_alpha * 2, 1.0 / N) / 2.0;
+        } else
+        {
+            ra = std::pow((self->overlay_alpha - 0.5) * 2, N) / 2.0 + 0.5;
+        }
+
+        /* The snapshot covers only a part of the view, find where it is now */
+        auto& shown    = self->displayed_geometry;
+        auto& original = self->snapshot_geometry;
+        auto& visible  = self->snapshot->geometry;
+        double sx = 1.0 * shown.width / std::max(1, original.width);
+        double sy = 1.0 * shown.height / std::max(1, original.height);
+        wf::geometry_t box = {
+            shown.x + (int)std::round((visible.x - original.x) * sx),
+            shown.y + (int)std::round((visible.y - original.y) * sy),
+            (int)std::round(visible.width * sx),
+            (int)std::round(visible.height * sy),
+        };
+
+        OpenGL::render_begin(target);
+        for (auto& damaged : region)
+        {
+            target.logic_scissor(wlr_box_from_pixman_box(damaged));
+            OpenGL::render_texture(self->snapshot->tex, target, box,
+                glm::vec4{1.0f, 1.0f, 1.0f, 1.0 - ra});
+        }
+
+        OpenGL::render_end();
+    }
+
+  private:
+    crossfade_node_t *self;
+};
+
+crossfade_node_t::crossfade_node_t(wayfire_toplevel_view view,
+    snapshot_pool_t& pool, double resolution) :
+    wf::scene::view_2d_transformer_t(view)
+{
+    auto output = view->get_output();
+    snapshot_geometry  = view->get_geometry();
+    displayed_geometry = snapshot_geometry;
+
+    /* Views are positioned relative to the current workspace of the output,
+     * so this is the part of the view which can be seen */
+    auto root    = view->get_surface_root_node();
+    auto visible = wf::geometry_intersection(root->get_bounding_box(),
+        output->get_relative_geometry());
+    if ((visible.width <= 0) || (visible.height <= 0))
+    {
+        return;
+    }
+
+    double scale = output->handle->scale * std::clamp(resolution, 0.1, 1.0);
+    snapshot = pool.acquire(
+        std::max(1, (int)std::ceil(scale * visible.width)),
+        std::max(1, (int)std::ceil(scale * visible.height)));
+    snapshot->geometry = visible;
+    snapshot->scale    = scale;
+
+    std::vector<wf::scene::render_instance_uptr> instances;
+    root->gen_render_instances(instances, [] (auto) {}, output);
+
+    wf::scene::render_pass_params_t params;
+    params.instances = &instances;
+    params.damage    = visible;
+    params.target    = *snapshot;
+    params.background_color = {0, 0, 0, 0};
+    wf::scene::run_render_pass(params, wf::scene::RPASS_CLEAR_BACKGROUND);
+}
+
+crossfade_node_t::~crossfade_node_t()
+{
+    if (snapshot)
+    {
+        OpenGL::render_begin();
+        snapshot->release();
+        OpenGL::render_end();
+    }
+}
+
+std::unique_ptr<wf::render_target_t> crossfade_node_t::take_snapshot()
+{
+    return std::move(snapshot);
+}
+
+void crossfade_node_t::gen_render_instances(
+    std::vector<wf::scene::render_instance_uptr>& instances,
+    wf::scene::damage_callback push_damage, wf::output_t *shown_on)
+{
+    /* Instances are ordered from front to back, the snapshot is on top */
+    instances.push_back(std::make_unique<crossfade_render_instance_t>(this));
+    wf::scene::view_2d_transformer_t::gen_render_instances(instances,
+        push_damage, shown_on);
+}
+}
+}
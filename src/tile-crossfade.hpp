@@ -0,0 +1,91 @@
+#ifndef WF_TILE_PLUGIN_TILE_CROSSFADE_HPP
+#define WF_TILE_PLUGIN_TILE_CROSSFADE_HPP
+
+#include <memory>
+#include <vector>
+
+#include <wayfire/opengl.hpp>
+#include <wayfire/output.hpp>
+#include <wayfire/toplevel-view.hpp>
+#include <wayfire/view-transform.hpp>
+
+namespace wf
+{
+namespace tile
+{
+/**
+ * Framebuffers for the crossfade snapshots of an output, so that views which
+ * start animating together or one after another reuse them instead of
+ * allocating and releasing a framebuffer each time.
+ */
+class snapshot_pool_t
+{
+  public:
+    /** Maximum number of unused framebuffers which are kept */
+    static constexpr size_t MAX_IDLE = 4;
+
+    snapshot_pool_t() = default;
+    ~snapshot_pool_t();
+
+    /** Get a cleared framebuffer of the given size, in pixels */
+    std::unique_ptr<wf::render_target_t> acquire(int width, int height);
+
+    /** Give a framebuffer back, it is released if enough are unused */
+    void release(std::unique_ptr<wf::render_target_t> buffer);
+
+    snapshot_pool_t(const snapshot_pool_t &) = delete;
+    snapshot_pool_t(snapshot_pool_t &&) = delete;
+    snapshot_pool_t& operator =(const snapshot_pool_t&) = delete;
+    snapshot_pool_t& operator =(snapshot_pool_t&&) = delete;
+
+  private:
+    std::vector<std::unique_ptr<wf::render_target_t>> idle;
+};
+
+/**
+ * A 2D transformer which fades out a snapshot of the view, taken when the
+ * transformer is created, over the current contents of the view.
+ *
+ * Unlike the crossfade node of the grid plugin, the snapshot comes from a
+ * snapshot_pool_t, covers only the part of the view which is on its output,
+ * and is captured at a fraction of the output resolution.
+ */
+class crossfade_node_t : public wf::scene::view_2d_transformer_t
+{
+  public:
+    /**
+     * @param resolution The resolution of the snapshot relative to the
+     *   resolution of the output, from 0.1 to 1.0
+     */
+    crossfade_node_t(wayfire_toplevel_view view, snapshot_pool_t& pool,
+        double resolution);
+    ~crossfade_node_t();
+
+    /** The box in which the view is shown */
+    wf::geometry_t displayed_geometry;
+    /** How far the snapshot has faded out, from 0.0 to 1.0 */
+    double overlay_alpha = 0.0;
+
+    /**
+     * Take the snapshot away, so that it can be given back to the pool
+     * before the transformer is removed. Nothing is faded out afterwards.
+     */
+    std::unique_ptr<wf::render_target_t> take_snapshot();
+
+    void gen_render_instances(
+        std::vector<wf::scene::render_instance_uptr>& instances,
+        wf::scene::damage_callback push_damage,
+        wf::output_t *shown_on) override;
+
+  private:
+    friend class crossfade_render_instance_t;
+
+    /** nullptr if the view was not on its output */
+    std::unique_ptr<wf::render_target_t> snapshot;
+    /** The geometry of the view when the snapshot was taken */
+    wf::geometry_t snapshot_geometry;
+};
+}
+}
+
+#endif /* end of include guard: WF_TILE_PLUGIN_TILE_CROSSFADE_HPP */
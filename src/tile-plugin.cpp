@@ -4,10 +4,18 @@
 #include <wayfire/matcher.hpp>
 #include <wayfire/signal-definitions.hpp>
 #include <wayfire/workarea.hpp>
+#include <wayfire/render-manager.hpp>
+#include <wayfire/util.hpp>
+#include <wayfire/plugins/common/shared-core-data.hpp>
+#include <wayfire/plugins/ipc/ipc-method-repository.hpp>
 
 #include "tree-controller.hpp"
+#include "tile-animation.hpp"
+#include "tile-stats.hpp"
 
+#include <algorithm>
 #include <iostream>
+#include <sstream>
 
 namespace wf
 {
@@ -33,12 +41,12 @@ class tile_workspace_implementation_t : public wf::workspace_implementation_t
   public:
     bool view_movable(wayfire_view /*view*/) override
     {
-        return true; //wf::tile::view_node_t::get_node(view) == nullptr;
+        return true; //wf::tile::get_view_node(view) == nullptr;
     }
 
     bool view_resizable(wayfire_view view) override
     {
-        return wf::tile::view_node_t::get_node(view) == nullptr;
+        return wf::tile::get_view_node(view) == nullptr;
     }
 };
 
@@ -46,14 +54,123 @@ class tile_workspace_implementation_t : public wf::workspace_implementation_t
  * When a view is moved from one output to the other, we want to keep its tiled
  * status. To achieve this, we do the following:
  *
- * 1. In view-pre-moved-to-output handler, we set view_auto_tile_t custom data.
- * 2. In detach handler, we just remove the view as usual.
+ * 1. In view-pre-moved-to-output handler, the old output takes the view node
+ *    out of its tree and stashes it in view_auto_tile_t custom data.
+ * 2. In detach handler, there is nothing left to remove.
  * 3. We now know we will receive attach as next event.
- *    Check for view_auto_tile_t, and tile the view again.
+ *    Check for view_auto_tile_t, and put the stashed node in the new tree.
  */
 class view_auto_tile_t : public wf::custom_data_t
+{
+  public:
+    /** The stashed view node, if the old output had one */
+    std::unique_ptr<wf::tile::tree_node_t> node;
+};
+
+/**
+ * Marks a tiled view which is counted in the fullscreen count of its
+ * workspace, so that the count follows the fullscreen state of the view no
+ * matter who changes it.
+ */
+class view_fullscreen_counted_t : public wf::custom_data_t
 {};
 
+/**
+ * Marks an output on which a tiling plugin instance runs, so that a view
+ * moving to another output only takes its node along if the new output has
+ * an instance to claim it. It is stored in init() and erased in fini().
+ */
+class output_tiling_t : public wf::custom_data_t
+{};
+
+/**
+ * Exposes the plugin statistics as the better-tiling/stats IPC method. It is
+ * shared between the plugin instances of all outputs.
+ */
+class tile_stats_ipc_t
+{
+  public:
+    tile_stats_ipc_t()
+    {
+        ipc_repo->register_method("better-tiling/stats", get_stats);
+    }
+
+    ~tile_stats_ipc_t()
+    {
+        ipc_repo->unregister_method("better-tiling/stats");
+    }
+
+  private:
+    wf::shared_data::ref_ptr_t<wf::ipc::method_repository_t> ipc_repo;
+
+    wf::ipc::method_callback get_stats = [=] (nlohmann::json)
+    {
+        const auto& stats = wf::tile::get_stats();
+
+        auto response = wf::ipc::json_ok();
+        response["transactions"]    = stats.transactions;
+        response["views-committed"] = stats.views_committed;
+        response["views-skipped"]   = stats.views_skipped;
+        response["motions-coalesced"] = stats.motions_coalesced;
+        response["sublayers"] = stats.sublayers;
+        response["relayouts-saved"] = stats.relayouts_saved;
+        response["layouts-restored"] = stats.layouts_restored;
+        response["animations"] = {
+            {"started", stats.animations_started},
+            {"over-limit", stats.animations_over_limit},
+            {"slow-frames", stats.animations_slow_frames},
+            {"offscreen", stats.animations_offscreen},
+        };
+        response["last-transaction"] = {
+            {"committed", stats.last_tx_committed},
+            {"skipped", stats.last_tx_skipped},
+        };
+
+        return response;
+    };
+};
+
+/**
+ * Collects option changes made within one iteration of the event loop, for
+ * example by a config reload which changes several options at once, and runs
+ * each affected update only once, when the event loop becomes idle.
+ */
+class option_batcher_t
+{
+  public:
+    /** Run the update once the current batch of option changes is over */
+    void schedule(std::function<void()> *update)
+    {
+        if (std::find(pending.begin(), pending.end(), update) != pending.end())
+        {
+            wf::tile::get_stats().relayouts_saved++;
+            return;
+        }
+
+        pending.push_back(update);
+        if (!idle_apply.is_connected())
+        {
+            idle_apply.run_once([=] () { flush(); });
+        }
+    }
+
+    /** Run the pending updates now */
+    void flush()
+    {
+        idle_apply.disconnect();
+        auto updates = std::move(pending);
+        pending.clear();
+        for (auto update : updates)
+        {
+            (*update)();
+        }
+    }
+
+  private:
+    wf::wl_idle_call idle_apply;
+    std::vector<std::function<void()>*> pending;
+};
+
 class tile_plugin_t : public wf::plugin_interface_t
 {
   private:
@@ -68,7 +185,9 @@ class tile_plugin_t : public wf::plugin_interface_t
         "better-tiling/keep_fullscreen_on_adjacent"};
     wf::option_wrapper_t<wf::buttonbinding_t>
         button_move{"better-tiling/button_move"},
-        button_resize{"better-tiling/button_resize"};
+        button_resize{"better-tiling/button_resize"},
+        button_resize_preview{"better-tiling/button_resize_preview"};
+    wf::option_wrapper_t<bool> resize_preview{"better-tiling/resize_preview"};
     wf::option_wrapper_t<wf::keybinding_t> key_toggle_tile{"better-tiling/key_toggle"};
 
     wf::option_wrapper_t<wf::keybinding_t>
@@ -91,6 +210,12 @@ class tile_plugin_t : public wf::plugin_interface_t
         key_move_above{"better-tiling/key_move_above"},
         key_move_below{"better-tiling/key_move_below"};
 
+    wf::option_wrapper_t<wf::keybinding_t>
+        key_send_group_left{"better-tiling/key_send_group_left"},
+        key_send_group_right{"better-tiling/key_send_group_right"},
+        key_send_group_above{"better-tiling/key_send_group_above"},
+        key_send_group_below{"better-tiling/key_send_group_below"};
+
     wf::option_wrapper_t<int> inner_gaps{"better-tiling/inner_gap_size"};
     wf::option_wrapper_t<int> outer_horiz_gaps{"better-tiling/outer_horiz_gap_size"};
     wf::option_wrapper_t<int> outer_vert_gaps{"better-tiling/outer_vert_gap_size"};
@@ -99,7 +224,36 @@ class tile_plugin_t : public wf::plugin_interface_t
      * Initialize other variables and defaults.
      */
     std::vector<std::vector<std::unique_ptr<wf::tile::tree_node_t>>> roots;
+    /** The sublayer of the tiled views of each workspace, created when the
+     * first view is tiled there, and destroyed when the tree is empty again */
     std::vector<std::vector<nonstd::observer_ptr<wf::sublayer_t>>> tiled_sublayer;
+    /** Number of fullscreen tiled views on each workspace, see
+     * sync_fullscreen_count() */
+    std::vector<std::vector<int>> fullscreen_count;
+
+    /**
+     * Update the fullscreen count of the workspace vp for the view, counting
+     * it if it is tiled and fullscreen, and uncounting it otherwise.
+     */
+    void sync_fullscreen_count(wayfire_view view, wf::point_t vp,
+        bool tiled = true)
+    {
+        bool counted    = view->has_data<wf::view_fullscreen_counted_t>();
+        bool fullscreen = tiled && view->pending_fullscreen();
+        if (counted == fullscreen)
+        {
+            return;
+        }
+
+        fullscreen_count[vp.x][vp.y] += fullscreen ? 1 : -1;
+        if (fullscreen)
+        {
+            view->store_data(std::make_unique<wf::view_fullscreen_counted_t>());
+        } else
+        {
+            view->erase_data<wf::view_fullscreen_counted_t>();
+        }
+    }
 
     const wf::tile::split_direction_t default_split = wf::tile::SPLIT_VERTICAL;
     wf::tile::split_direction_t split_direction = wf::tile::SPLIT_VERTICAL;
@@ -109,45 +263,117 @@ class tile_plugin_t : public wf::plugin_interface_t
         resize_roots(output->wset()->get_workspace_grid_size());
     };
 
+    /**
+     * Adapt the trees to a new workspace grid size. Workspaces which exist in
+     * both grids keep their trees and sublayers. The views of removed
+     * workspaces are moved to the nearest remaining workspace.
+     */
     void resize_roots(wf::dimensions_t wsize)
     {
-        for (size_t i = 0; i < tiled_sublayer.size(); i++)
+        struct removed_root_t
         {
-            for (size_t j = 0; j < tiled_sublayer[i].size(); j++)
+            std::unique_ptr<wf::tile::tree_node_t> root;
+            wf::point_t target;
+        };
+
+        std::vector<removed_root_t> removed;
+        std::vector<wf::point_t> removed_workspaces;
+        for (size_t i = 0; i < roots.size(); i++)
+        {
+            for (size_t j = 0; j < roots[i].size(); j++)
             {
-                if (!output->wset()->is_workspace_valid({(int)i, (int)j}))
+                if (((int)i < wsize.width) && ((int)j < wsize.height))
+                {
+                    continue;
+                }
+
+                wf::point_t target = {
+                    std::min((int)i, wsize.width - 1),
+                    std::min((int)j, wsize.height - 1),
+                };
+
+                if (!roots[i][j]->get_children().empty())
                 {
-                    output->wset()->destroy_sublayer(tiled_sublayer[i][j]);
-                    roots[i][j].reset();
+                    removed.push_back({std::move(roots[i][j]), target});
                 }
+
+                removed_workspaces.push_back({(int)i, (int)j});
             }
         }
 
+        /* The views move to the sublayers of their new workspaces before the
+         * sublayers of the removed workspaces are destroyed. The new
+         * workspaces are kept, so their sublayers can be created already. */
+        for (auto& r : removed)
+        {
+            tile::for_each_view(r.root, [&] (wayfire_toplevel_view view)
+            {
+                output->wset()->add_view_to_sublayer(view,
+                    get_sublayer(r.target));
+            });
+        }
+
+        for (auto& vp : removed_workspaces)
+        {
+            destroy_sublayer(vp);
+        }
+
         roots.resize(wsize.width);
         tiled_sublayer.resize(wsize.width);
+        fullscreen_count.resize(wsize.width);
         for (int i = 0; i < wsize.width; i++)
         {
             roots[i].resize(wsize.height);
             tiled_sublayer[i].resize(wsize.height);
+            fullscreen_count[i].resize(wsize.height, 0);
             for (int j = 0; j < wsize.height; j++)
             {
-                roots[i][j] =
-                    std::make_unique<wf::tile::split_node_t>(default_split);
-                tiled_sublayer[i][j] = output->wset()->create_sublayer(
-                    wf::LAYER_WORKSPACE, wf::SUBLAYER_FLOATING);
+                if (!roots[i][j])
+                {
+                    roots[i][j] =
+                        std::make_unique<wf::tile::split_node_t>(default_split);
+                    roots[i][j]->set_gaps(get_root_gaps());
+                }
             }
         }
 
-        update_root_size(output->workarea->get_workarea());
+        set_root_size(output->workarea->get_workarea());
+
+        /* The moved views and the current workspace go in one transaction.
+         * The moved views are laid out even if their new workspace is not
+         * visible, because they are on no workspace until then. */
+        tile::wayfire_transaction_t tx;
+        for (auto& r : removed)
+        {
+            auto& target = roots[r.target.x][r.target.y];
+            auto removed_split = r.root->as_split_node();
+            while (!removed_split->get_children().empty())
+            {
+                auto child = removed_split->remove_child(removed_split->get_child(0));
+                tile::for_each_view(child, [&] (wayfire_toplevel_view view)
+                {
+                    /* The count of the removed workspace is gone already */
+                    view->erase_data<wf::view_fullscreen_counted_t>();
+                    sync_fullscreen_count(view, r.target);
+                });
+                target->as_split_node()->add_child(std::move(child));
+            }
+
+            tile::layout_tree(target, tx);
+        }
+
+        auto vp = output->wset()->get_current_workspace();
+        tile::layout_tree(roots[vp.x][vp.y], tx);
+        tile::schedule_layout_transaction(tx);
     }
 
-    void update_root_size(wf::geometry_t workarea)
+    /** Set the geometry of all roots, for the given workarea */
+    void set_root_size(wf::geometry_t workarea)
     {
         auto output_geometry = output->get_relative_geometry();
-        auto wsize = output->wset()->get_workspace_grid_size();
-        for (int i = 0; i < wsize.width; i++)
+        for (size_t i = 0; i < roots.size(); i++)
         {
-            for (int j = 0; j < wsize.height; j++)
+            for (size_t j = 0; j < roots[i].size(); j++)
             {
                 /* Set size */
                 auto vp_geometry = workarea;
@@ -158,24 +384,197 @@ class tile_plugin_t : public wf::plugin_interface_t
         }
     }
 
-    std::function<void()> update_gaps = [=] ()
+    void update_root_size(wf::geometry_t workarea)
+    {
+        set_root_size(workarea);
+        apply_layout();
+    }
+
+    /**
+     * Lay out the tree of the current workspace. Only nodes which were marked
+     * dirty by earlier tree mutations are recalculated.
+     *
+     * The trees of the other workspaces are left dirty, i.e. stale, so that
+     * their views are not configured for changes which nobody can see. They
+     * are laid out when they become visible, see flush_stale_layouts().
+     */
+    void apply_layout()
+    {
+        auto vp = output->wset()->get_current_workspace();
+        apply_layout(roots[vp.x][vp.y]);
+    }
+
+    /** Lay out the tree which contains the given node, if it is visible. */
+    void apply_layout(nonstd::observer_ptr<tile::tree_node_t> node)
+    {
+        auto root = tile::get_root(node);
+        auto vp   = output->wset()->get_current_workspace();
+        if (root.get() != roots[vp.x][vp.y].get())
+        {
+            return;
+        }
+
+        tile::wayfire_transaction_t tx;
+        tile::layout_tree(root, tx);
+        tile::schedule_layout_transaction(tx);
+    }
+
+    /** Find the workspace whose tree contains the given node */
+    wf::point_t get_node_workspace(nonstd::observer_ptr<tile::tree_node_t> node)
+    {
+        auto root = tile::get_root(node);
+        for (size_t i = 0; i < roots.size(); i++)
+        {
+            for (size_t j = 0; j < roots[i].size(); j++)
+            {
+                if (roots[i][j].get() == root.get())
+                {
+                    return {(int)i, (int)j};
+                }
+            }
+        }
+
+        return output->wset()->get_current_workspace();
+    }
+
+    /** Get the sublayer for tiled views of the workspace, creating it if needed */
+    nonstd::observer_ptr<wf::sublayer_t> get_sublayer(wf::point_t vp)
+    {
+        auto& sublayer = tiled_sublayer[vp.x][vp.y];
+        if (!sublayer)
+        {
+            sublayer = output->wset()->create_sublayer(
+                wf::LAYER_WORKSPACE, wf::SUBLAYER_FLOATING);
+            tile::get_stats().sublayers++;
+        }
+
+        return sublayer;
+    }
+
+    void destroy_sublayer(wf::point_t vp)
+    {
+        auto& sublayer = tiled_sublayer[vp.x][vp.y];
+        if (sublayer)
+        {
+            output->wset()->destroy_sublayer(sublayer);
+            sublayer = nullptr;
+            tile::get_stats().sublayers--;
+        }
+    }
+
+    /** Destroy the sublayer of the workspace if its tree has no views left */
+    void release_sublayer(wf::point_t vp)
+    {
+        if (roots[vp.x][vp.y]->get_children().empty())
+        {
+            destroy_sublayer(vp);
+        }
+    }
+
+    /** Check whether the node is in one of the trees of this output */
+    bool owns_node(nonstd::observer_ptr<tile::tree_node_t> node)
+    {
+        auto root = tile::get_root(node);
+        for (auto& col : roots)
+        {
+            for (auto& r : col)
+            {
+                if (r.get() == root.get())
+                {
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * Move the node with its whole subtree to the root of the workspace vp.
+     * The subtree keeps its proportions, and the trees of both workspaces
+     * are laid out in a single transaction. Nothing happens if the node is
+     * on vp already.
+     */
+    void transplant_node(nonstd::observer_ptr<tile::tree_node_t> node,
+        wf::point_t vp)
+    {
+        auto from = get_node_workspace(node);
+        if (from == vp)
+        {
+            return;
+        }
+
+        stop_controller(true);
+        auto target = roots[vp.x][vp.y]->as_split_node();
+
+        tile::transplant_node(node, target);
+        tile::for_each_view(node, [&] (wayfire_toplevel_view view)
+        {
+            output->wset()->add_view_to_sublayer(view, get_sublayer(vp));
+            sync_fullscreen_count(view, from, false);
+            sync_fullscreen_count(view, vp);
+        });
+        release_sublayer(from);
+
+        /* The views of the subtree which did not change their workspace
+         * themselves are moved to vp by laying out its tree. The old tree
+         * is only laid out if it is visible, otherwise it is stale. */
+        auto current = output->wset()->get_current_workspace();
+        tile::wayfire_transaction_t tx;
+        tile::layout_tree(roots[vp.x][vp.y], tx);
+        if (from == current)
+        {
+            tile::layout_tree(roots[current.x][current.y], tx);
+        }
+
+        tile::schedule_layout_transaction(tx);
+    }
+
+    /** Lay out the stale trees of all workspaces in a single transaction. */
+    void flush_stale_layouts()
     {
-        tile::gap_size_t gaps = {
+        tile::wayfire_transaction_t tx;
+        for (auto& col : roots)
+        {
+            for (auto& root : col)
+            {
+                tile::layout_tree(root, tx);
+            }
+        }
+
+        tile::schedule_layout_transaction(tx);
+    }
+
+    /** The gaps of the roots, from the gap options */
+    tile::gap_size_t get_root_gaps()
+    {
+        return {
             .left   = outer_horiz_gaps,
             .right  = outer_horiz_gaps,
             .top    = outer_vert_gaps,
             .bottom = outer_vert_gaps,
             .internal = inner_gaps,
         };
+    }
 
+    std::function<void()> update_gaps = [=] ()
+    {
+        auto gaps = get_root_gaps();
         for (auto& col : roots)
         {
             for (auto& root : col)
             {
                 root->set_gaps(gaps);
-                root->set_geometry(root->geometry);
             }
         }
+
+        apply_layout();
+    };
+
+    option_batcher_t option_batcher;
+    std::function<void()> schedule_update_gaps = [=] ()
+    {
+        option_batcher.schedule(&update_gaps);
     };
 
     bool can_tile_view(wayfire_view view)
@@ -193,6 +592,8 @@ class tile_plugin_t : public wf::plugin_interface_t
         return true;
     }
 
+    wf::shared_data::ref_ptr_t<tile_stats_ipc_t> stats_ipc;
+
     std::unique_ptr<wf::tile::tile_controller_t> controller =
         std::make_unique<wf::tile::tile_controller_t>();
 
@@ -217,21 +618,14 @@ class tile_plugin_t : public wf::plugin_interface_t
      */
     nonstd::observer_ptr<tile::view_node_t> get_active_node()
     {
-        return tile::view_node_t::get_node(output->get_active_view());
+        return tile::get_view_node(output->get_active_view());
     }
 
     /** Check whether we currently have a fullscreen tiled view */
     bool has_fullscreen_view()
     {
         auto vp = output->wset()->get_current_workspace();
-
-        int count_fullscreen = 0;
-        for_each_view(roots[vp.x][vp.y], [&] (wayfire_view view)
-        {
-            count_fullscreen += view->fullscreen;
-        });
-
-        return count_fullscreen > 0;
+        return fullscreen_count[vp.x][vp.y] > 0;
     }
 
     /** Check whether the current pointer focus is tiled view */
@@ -239,11 +633,11 @@ class tile_plugin_t : public wf::plugin_interface_t
     {
         auto focus = wf::get_core().get_cursor_focus_view();
 
-        return focus && tile::view_node_t::get_node(focus);
+        return focus && tile::get_view_node(focus);
     }
 
-    template<class Controller>
-    bool start_controller()
+    template<class Controller, class... Args>
+    bool start_controller(Args... args)
     {
         /* No action possible in this case */
         if (has_fullscreen_view() || !has_tiled_focus())
@@ -260,7 +654,7 @@ class tile_plugin_t : public wf::plugin_interface_t
         {
             auto vp = output->wset()->get_current_workspace();
             controller = std::make_unique<Controller>(
-                roots[vp.x][vp.y], get_global_input_coordinates());
+                roots[vp.x][vp.y], get_global_input_coordinates(), args...);
         } else
         {
             output->deactivate_plugin(grab_interface);
@@ -286,7 +680,14 @@ class tile_plugin_t : public wf::plugin_interface_t
         controller = std::make_unique<wf::tile::tile_controller_t>();
     }
 
-    void attach_view(wayfire_view view, wf::point_t vp = {-1, -1})
+    /**
+     * Tile the view on the workspace vp, or next to the focused view.
+     *
+     * @param node The node of the view if it already has one, for example
+     *             when the view comes from another output
+     */
+    void attach_view(wayfire_view view, wf::point_t vp = {-1, -1},
+        std::unique_ptr<tile::tree_node_t> node = nullptr)
     {
         if (!can_tile_view(view))
         {
@@ -303,9 +704,9 @@ class tile_plugin_t : public wf::plugin_interface_t
 
             /* Try to add this node to the focused node. */
             auto focused_node = get_active_node();
-            if (focused_node && focused_node->parent)
+            if (focused_node && focused_node->get_parent())
             {
-                parent_split = focused_node->parent;
+                parent_split = focused_node->get_parent();
 
                 // /* Create a new split if the split direction of the parent
                 //    does not agree with the requested split direction. */
@@ -334,9 +735,16 @@ class tile_plugin_t : public wf::plugin_interface_t
         }
 
         // Add this node to the root.
-        auto view_node = std::make_unique<wf::tile::view_node_t>(view);
-        parent_split->add_child(std::move(view_node));
-        output->wset()->add_view_to_sublayer(view, tiled_sublayer[vp.x][vp.y]);
+        if (!node)
+        {
+            node = wf::tile::create_view_node(view);
+        }
+
+        parent_split->add_child(std::move(node));
+        output->wset()->add_view_to_sublayer(view, get_sublayer(vp));
+        sync_fullscreen_count(view, vp);
+
+        apply_layout(parent_split);
     }
 
     bool tile_window_by_default(wayfire_view view)
@@ -349,7 +757,12 @@ class tile_plugin_t : public wf::plugin_interface_t
     signal_connection_t on_view_attached = [=] (signal_data_t *data)
     {
         auto view = get_signaled_view(data);
-        if (view->has_data<view_auto_tile_t>() || tile_window_by_default(view))
+        if (view->has_data<view_auto_tile_t>())
+        {
+            auto node = std::move(view->get_data<view_auto_tile_t>()->node);
+            view->erase_data<view_auto_tile_t>();
+            attach_view(view, {-1, -1}, std::move(node));
+        } else if (tile_window_by_default(view))
         {
             attach_view(view);
         }
@@ -358,18 +771,48 @@ class tile_plugin_t : public wf::plugin_interface_t
     signal_connection_t on_view_unmapped = [=] (signal_data_t *data)
     {
         stop_controller(true);
-        auto node = wf::tile::view_node_t::get_node(get_signaled_view(data));
-        if (node)
+        auto view = get_signaled_view(data);
+        auto node = wf::tile::get_view_node(view);
+        if (node && node->get_parent())
         {
             detach_view(node);
         }
+
+        /* Drop a node stashed for another output, while the view is alive */
+        view->erase_data<view_auto_tile_t>();
     };
 
     signal_connection_t on_view_pre_moved_to_output = [=] (signal_data_t *data)
     {
         auto ev   = static_cast<wf::view_pre_moved_to_output_signal*>(data);
-        auto node = wf::tile::view_node_t::get_node(ev->view);
-        if ((ev->new_output == this->output) && node)
+        auto node = wf::tile::get_view_node(ev->view);
+        if (!node || !node->get_parent())
+        {
+            return;
+        }
+
+        bool new_output_tiles = ev->new_output &&
+            ev->new_output->has_data<wf::output_tiling_t>();
+
+        if ((ev->new_output != this->output) && owns_node(node) &&
+            new_output_tiles)
+        {
+            /* Take the node with us, so that the view keeps its tiling state
+             * instead of being detached and tiled again. Without an instance
+             * on the new output nobody would claim the node, and the view is
+             * detached as usual. */
+            stop_controller(true);
+            auto stash = std::make_unique<wf::view_auto_tile_t>();
+            auto vp    = get_node_workspace(node);
+            sync_fullscreen_count(ev->view, vp, false);
+
+            nonstd::observer_ptr<tile::split_node_t> remaining;
+            stash->node = tile::remove_node(node, remaining);
+            apply_layout(remaining);
+            release_sublayer(vp);
+            ev->view->store_data(std::move(stash));
+        } else if ((ev->new_output == this->output) &&
+                   !ev->view->has_data<view_auto_tile_t>())
         {
             ev->view->store_data(std::make_unique<wf::view_auto_tile_t>());
         }
@@ -380,20 +823,16 @@ class tile_plugin_t : public wf::plugin_interface_t
         bool reinsert = true)
     {
         stop_controller(true);
-        auto wview = view->view;
-
-        auto parent = view->parent;
-        parent->remove_child(view);
+        auto wview = tile::get_wayfire_view(view);
+        auto vp    = get_node_workspace(view);
+        sync_fullscreen_count(wview, vp, false);
 
         /* Remove parents if they are now empty. */
-        while (parent->children.size() == 0 && parent->parent != nullptr)
-        {
-            auto parent_parent = parent->parent;
-            parent_parent->remove_child(parent);
-            parent = parent_parent;
-        }
+        nonstd::observer_ptr<tile::split_node_t> parent;
+        tile::remove_node(view, parent);
 
         // Maybe flatten parent.
+        apply_layout(parent);
 
         if (wview->fullscreen && wview->is_mapped())
         {
@@ -405,28 +844,124 @@ class tile_plugin_t : public wf::plugin_interface_t
         {
             output->wset()->add_view(wview, wf::LAYER_WORKSPACE);
         }
+
+        release_sublayer(vp);
     }
 
     signal_connection_t on_view_detached = [=] (signal_data_t *data)
     {
         auto view = get_signaled_view(data);
-        auto view_node = wf::tile::view_node_t::get_node(view);
+        auto view_node = wf::tile::get_view_node(view);
 
-        if (view_node)
+        /* A node without parent is stashed for another output */
+        if (view_node && view_node->get_parent())
         {
             detach_view(view_node, false);
         }
     };
 
+    /*
+     * Workarea changes, e.g. from an autohiding panel which slides in and out,
+     * can arrive many times per frame. They are coalesced, so that the trees
+     * are resized at most once per frame.
+     */
+    wf::option_wrapper_t<int> workarea_settle_time{"better-tiling/workarea_settle_time"};
+    bool workarea_hook_active = false;
+    wf::wl_timer workarea_settle_timer;
+
     signal_connection_t on_workarea_changed = [=] (signal_data_t */*data*/)
     {
-        update_root_size(output->workarea->get_workarea());
+        if (!workarea_hook_active)
+        {
+            workarea_hook_active = true;
+            output->render->add_effect(&on_workarea_frame, wf::OUTPUT_EFFECT_PRE);
+            output->render->schedule_redraw();
+        }
+    };
+
+    wf::effect_hook_t on_workarea_frame = [=] ()
+    {
+        output->render->rem_effect(&on_workarea_frame);
+        workarea_hook_active = false;
+
+        if (workarea_settle_time <= 0)
+        {
+            update_root_size(output->workarea->get_workarea());
+            return;
+        }
+
+        /* Only scale the views until the workarea stops changing, then send
+         * them their real size. */
+        set_root_size(output->workarea->get_workarea());
+        auto vp = output->wset()->get_current_workspace();
+        tile::preview_layout(roots[vp.x][vp.y]);
+
+        workarea_settle_timer.disconnect();
+        workarea_settle_timer.set_timeout(workarea_settle_time, [=] ()
+        {
+            apply_layout();
+            return false;
+        });
+    };
+
+    signal_connection_t on_workspace_changed = [=] (signal_data_t */*data*/)
+    {
+        /* The tree of the new workspace may be stale */
+        apply_layout();
+    };
+
+    /**
+     * The plugins which show the other workspaces, and so query the geometry
+     * of their views. Stale trees are laid out when one of them is activated.
+     *
+     * Only the reads we can see are covered: the current workspace is always
+     * laid out, and so is the workspace of a view which is asked to get the
+     * focus. A plugin which is not in the list, or an IPC client which reads
+     * the geometry of a view on a hidden workspace, still gets the geometry
+     * the view had before the tree went stale.
+     */
+    wf::option_wrapper_t<std::string> flush_plugins{
+        "better-tiling/stale_layout_plugins"};
+
+    signal_connection_t on_plugin_activation_changed = [=] (signal_data_t *data)
+    {
+        auto ev = static_cast<wf::output_plugin_activated_changed_signal*>(data);
+        if (!ev->activated || (ev->plugin_name == grab_interface->name))
+        {
+            return;
+        }
+
+        std::istringstream names{(std::string)flush_plugins};
+        std::string name;
+        while (names >> name)
+        {
+            if (name == ev->plugin_name)
+            {
+                flush_stale_layouts();
+                return;
+            }
+        }
+    };
+
+    /** A view on a hidden workspace is about to be shown, e.g. by a taskbar,
+     * which switches to the workspace of its geometry */
+    signal_connection_t on_focus_request = [=] (signal_data_t *data)
+    {
+        auto ev   = static_cast<wf::view_focus_request_signal*>(data);
+        auto node = tile::get_view_node(ev->view);
+        if (node && node->get_parent() && owns_node(node))
+        {
+            auto vp = get_node_workspace(node);
+            tile::wayfire_transaction_t tx;
+            tile::layout_tree(roots[vp.x][vp.y], tx);
+            tile::schedule_layout_transaction(tx);
+        }
     };
 
     signal_connection_t on_tile_request = [=] (signal_data_t *data)
     {
         auto ev = static_cast<view_tile_request_signal*>(data);
-        if (ev->carried_out || !tile::view_node_t::get_node(ev->view))
+        if (ev->carried_out || !tile::get_view_node(ev->view))
         {
             return;
         }
@@ -437,15 +972,23 @@ class tile_plugin_t : public wf::plugin_interface_t
 
     void set_view_fullscreen(wayfire_view view, bool fullscreen)
     {
-        /* Set fullscreen, and trigger resizing of the views */
+        auto node = tile::get_view_node(view);
+
+        /* Only the view itself changes its geometry. Its node keeps its place
+         * in the tree, so the siblings are not touched when entering
+         * fullscreen, and the view gets its node geometry back when leaving
+         * it. */
         view->set_fullscreen(fullscreen);
-        update_root_size(output->workarea->get_workarea());
+        sync_fullscreen_count(view, get_node_workspace(node));
+        node->mark_dirty();
+        apply_layout(node);
     }
 
     signal_connection_t on_fullscreen_request = [=] (signal_data_t *data)
     {
-        auto ev = static_cast<view_fullscreen_signal*>(data);
-        if (ev->carried_out || !tile::view_node_t::get_node(ev->view))
+        auto ev   = static_cast<view_fullscreen_signal*>(data);
+        auto node = tile::get_view_node(ev->view);
+        if (ev->carried_out || !node || !node->get_parent())
         {
             return;
         }
@@ -454,25 +997,33 @@ class tile_plugin_t : public wf::plugin_interface_t
         set_view_fullscreen(ev->view, ev->state);
     };
 
-    signal_connection_t on_focus_changed = [=] (signal_data_t *data)
+    /** Other plugins and the focus of a sibling change fullscreen as well */
+    signal_connection_t on_fullscreen_changed = [=] (signal_data_t *data)
     {
-        if (auto view = tile::view_node_t::get_node(get_signaled_view(data)))
+        auto ev   = static_cast<view_fullscreen_signal*>(data);
+        auto node = tile::get_view_node(ev->view);
+        if (node && node->get_parent() && owns_node(node))
         {
-            nonstd::observer_ptr<tile::tree_node_t> current = view;
+            sync_fullscreen_count(ev->view, get_node_workspace(node));
+        }
+    };
 
-            while (current->parent != nullptr)
+    signal_connection_t on_focus_changed = [=] (signal_data_t *data)
+    {
+        if (auto view = tile::get_view_node(get_signaled_view(data)))
+        {
+            for (auto current : view->get_path())
             {
+                auto parent = current->get_parent();
                 int idx = current->get_sibling_index();
-                if (idx != current->parent->get_focused_idx())
+                if (parent && (idx != parent->get_focused_idx()))
                 {
-                    current->parent->set_focused_idx(idx);
+                    parent->set_focused_idx(idx);
                 }
                 else
                 {
                     break;
                 }
-
-                current = current->parent;
             }
 
             //TODO: do fullscreen view better, prob store a pointer to is somewhere.
@@ -491,11 +1042,17 @@ class tile_plugin_t : public wf::plugin_interface_t
 
     void change_view_workspace(wayfire_view view, wf::point_t vp = {-1, -1})
     {
-        auto existing_node = wf::tile::view_node_t::get_node(view);
-        if (existing_node)
+        auto existing_node = wf::tile::get_view_node(view);
+        if (existing_node && existing_node->get_parent())
         {
-            detach_view(existing_node);
-            attach_view(view, vp);
+            if (vp == wf::point_t{-1, -1})
+            {
+                vp = output->wset()->get_current_workspace();
+            }
+
+            /* Only the view itself moves, even out of a tabbed group. Whole
+             * groups are sent with send_group_to_workspace(). */
+            transplant_node(existing_node, vp);
         }
     }
 
@@ -511,7 +1068,7 @@ class tile_plugin_t : public wf::plugin_interface_t
     signal_connection_t on_view_minimized = [=] (signal_data_t *data)
     {
         auto ev = (view_minimize_request_signal*)data;
-        auto existing_node = wf::tile::view_node_t::get_node(ev->view);
+        auto existing_node = wf::tile::get_view_node(ev->view);
 
         if (ev->state && existing_node)
         {
@@ -529,7 +1086,7 @@ class tile_plugin_t : public wf::plugin_interface_t
 
         if (view) // Maybe his is important but idk: && output->can_activate_plugin(grab_interface)
         {
-            auto existing_node = tile::view_node_t::get_node(view);
+            auto existing_node = tile::get_view_node(view);
             if (existing_node)
             {
                 detach_view(existing_node);
@@ -550,7 +1107,7 @@ class tile_plugin_t : public wf::plugin_interface_t
     {
         if (auto active_node = get_active_node())
         {
-            auto split = active_node->parent;
+            auto split = active_node->get_parent();
             if (split->is_tabbed())
             {
                 split->set_tabbed(false);
@@ -562,6 +1119,7 @@ class tile_plugin_t : public wf::plugin_interface_t
                         ? tile::SPLIT_VERTICAL: tile::SPLIT_HORIZONTAL);
             }
 
+            apply_layout(split);
             return true;
         }
 
@@ -578,9 +1136,9 @@ class tile_plugin_t : public wf::plugin_interface_t
         /* Try to change the split direction of the active view, or create a new split.*/
         if (auto focused_node = get_active_node())
         {
-            auto split = focused_node->parent;
+            auto split = focused_node->get_parent();
 
-            if (split->children.size() == 1)
+            if (split->get_children().size() == 1)
             {
                 /* Update the direction of the split. */
                 if (split->get_split_direction() != split_direction)
@@ -596,6 +1154,8 @@ class tile_plugin_t : public wf::plugin_interface_t
                 auto focused_node_ptr = split->replace_child(focused_node, std::move(new_split));
                 new_split_ptr->add_child(std::move(focused_node_ptr));
             }
+
+            apply_layout(split);
         }
 
         return true;
@@ -604,36 +1164,27 @@ class tile_plugin_t : public wf::plugin_interface_t
     wf::key_callback on_toggle_tabbed = [=] (wf::keybinding_t /*binding*/)
     {
         auto focused_node = get_active_node();
-        if (focused_node && focused_node->parent)
+        if (focused_node && focused_node->get_parent())
         {
-            auto split = focused_node->parent->as_split_node();
+            auto split = focused_node->get_parent()->as_split_node();
             split->set_tabbed(!split->is_tabbed());
+            apply_layout(split);
             return true;
         }
 
         return false;
     };
 
-    bool focus_adjacent(tile::split_direction_t axis, int direction)
+    bool focus_adjacent(tile::split_insertion_t direction)
     {
         if (auto active_node = get_active_node())
         {
-            /* Try to move the focus through the splits. */
-            nonstd::observer_ptr<tile::tree_node_t> current = active_node;
-            while (current->parent)
+            /* Focus the closest sibling in the direction, inside of it the
+             * most recently focused view gets the focus. */
+            auto adjacent = tile::find_adjacent(active_node, direction);
+            if (adjacent.split)
             {
-                int idx = current->get_sibling_index() + direction;
-
-                if (current->parent->get_split_direction() != axis
-                    || idx < 0 || idx >= (int)current->parent->children.size())
-                {
-                    current = current->parent;
-                }
-                else
-                {
-                    current->parent->focus(output, idx);
-                    break;
-                }
+                tile::focus_child(output, adjacent.split, adjacent.index);
             }
 
             return true;
@@ -660,90 +1211,81 @@ class tile_plugin_t : public wf::plugin_interface_t
     {
         if (binding == key_focus_left)
         {
-            return focus_adjacent(tile::SPLIT_VERTICAL, -1);
+            return focus_adjacent(tile::INSERT_LEFT);
         }
         else if (binding == key_focus_right)
         {
-            return focus_adjacent(tile::SPLIT_VERTICAL, 1);
+            return focus_adjacent(tile::INSERT_RIGHT);
         }
         else if (binding == key_focus_above)
         {
-            return focus_adjacent(tile::SPLIT_HORIZONTAL, -1);
+            return focus_adjacent(tile::INSERT_ABOVE);
         }
         else if (binding == key_focus_below)
         {
-            return focus_adjacent(tile::SPLIT_HORIZONTAL, 1);
+            return focus_adjacent(tile::INSERT_BELOW);
         }
 
         return false;
     };
 
-    bool move_adjacent(tile::split_direction_t axis, int direction)
+    bool move_adjacent(tile::split_insertion_t direction)
     {
         if (auto view_node = get_active_node())
         {
-            nonstd::observer_ptr<tile::tree_node_t> current = view_node;
-            auto view_parent = view_node->parent->as_split_node();
+            auto view_parent = view_node->get_parent()->as_split_node();
+            int step = (direction == tile::INSERT_LEFT ||
+                direction == tile::INSERT_ABOVE) ? -1 : 1;
 
-            /* Try to move the view through the splits. */
-            while (current->parent)
+            /* The closest split along the axis of the movement. */
+            auto target = tile::find_split_ancestor(view_node, direction);
+            if (target.split == view_parent)
             {
-                /* Move one up if the parent split is not the right direction. */
-                auto parent = current->parent;
-                if (parent->get_split_direction() != axis)
+                int new_idx = target.index + step;
+                if (new_idx >= 0 && new_idx < (int)view_parent->get_children().size())
                 {
-                    current = parent;
-                    continue;
-                }
-
-                int new_idx = current->get_sibling_index();
-
-                if (current == view_node)
-                {
-                    new_idx += direction;
-
-                    /* The new index is outside of the range of the current
-                     * split, so we must move the view outside of its current
-                     * split. */
-                    if (new_idx < 0 || new_idx >= (int)parent->children.size())
-                    {
-                        /* Move one split up. */
-                        current = parent;
-                        continue;
-                    }
+                    auto neighbour = view_parent->get_child(new_idx)->as_split_node();
+                    auto ptr = view_parent->remove_child(view_node);
 
                     /* Move the view inside of the neighbour split if able.*/
-                    if (auto neighbour = parent->children[new_idx]->as_split_node())
+                    if (neighbour)
                     {
                         // TODO differ based on split direction.
-                        auto ptr = view_node->parent->remove_child(view_node);
-                        neighbour->add_child(std::move(ptr), direction == 1 ? 0 : -1);
-                        break;
+                        neighbour->add_child(std::move(ptr), step == 1 ? 0 : -1);
+                    } else
+                    {
+                        view_parent->add_child(std::move(ptr), new_idx);
                     }
-                }
-                else
+
+                    target.split = nullptr;
+                } else
                 {
-                    new_idx += direction > 0 ? 1 : 0;
+                    /* The view is at the edge of its split, so it must move
+                     * outside of it, next to its split. */
+                    target = tile::find_split_ancestor(view_parent, direction);
                 }
+            }
 
-                /* Move the view above/below the node */
-                auto ptr = view_node->parent->remove_child(view_node, false);
-                parent->add_child(std::move(ptr), new_idx, false);
-                break;
+            /* Move the view above/below the node */
+            if (target.split)
+            {
+                auto ptr = view_parent->remove_child(view_node);
+                target.split->add_child(std::move(ptr), target.index + (step > 0 ? 1 : 0));
             }
 
-            if (view_node->parent != view_parent)
+            if (view_node->get_parent() != view_parent)
             {
                 /* Remove any splits that are now empty. */
-                while (view_parent->children.size() == 0
-                       && view_parent->parent != nullptr)
+                while (view_parent->get_children().size() == 0
+                       && view_parent->get_parent() != nullptr)
                 {
-                    auto view_parent_parent = view_parent->parent;
+                    auto view_parent_parent = view_parent->get_parent();
                     view_parent_parent->remove_child(view_parent);
                     view_parent = view_parent_parent;
                 }
             }
 
+            apply_layout(view_node);
             return true;
         }
 
@@ -756,19 +1298,96 @@ class tile_plugin_t : public wf::plugin_interface_t
     {
         if (binding == key_move_left)
         {
-            return move_adjacent(tile::SPLIT_VERTICAL, -1);
+            return move_adjacent(tile::INSERT_LEFT);
         }
         else if (binding == key_move_right)
         {
-            return move_adjacent(tile::SPLIT_VERTICAL, 1);
+            return move_adjacent(tile::INSERT_RIGHT);
         }
         else if (binding == key_move_above)
         {
-            return move_adjacent(tile::SPLIT_HORIZONTAL, -1);
+            return move_adjacent(tile::INSERT_ABOVE);
         }
         else if (binding == key_move_below)
         {
-            return move_adjacent(tile::SPLIT_HORIZONTAL, 1);
+            return move_adjacent(tile::INSERT_BELOW);
+        }
+
+        return false;
+    };
+
+    /**
+     * Send the tabbed group of the focused view, or the view itself if it is
+     * not in a tabbed split, to the adjacent workspace in the direction. The
+     * group keeps its tabs and their proportions.
+     */
+    bool send_group_to_workspace(tile::split_insertion_t direction)
+    {
+        auto active_node = get_active_node();
+        if (!active_node)
+        {
+            return false;
+        }
+
+        nonstd::observer_ptr<tile::tree_node_t> group = active_node;
+        while (group->get_parent()->get_parent() &&
+               group->get_parent()->is_tabbed())
+        {
+            group = group->get_parent();
+        }
+
+        auto vp    = get_node_workspace(group);
+        auto wsize = output->wset()->get_workspace_grid_size();
+        switch (direction)
+        {
+          case tile::INSERT_LEFT:
+            vp.x--;
+            break;
+
+          case tile::INSERT_RIGHT:
+            vp.x++;
+            break;
+
+          case tile::INSERT_ABOVE:
+            vp.y--;
+            break;
+
+          case tile::INSERT_BELOW:
+            vp.y++;
+            break;
+
+          default:
+            return false;
+        }
+
+        if ((vp.x < 0) || (vp.y < 0) || (vp.x >= wsize.width) ||
+            (vp.y >= wsize.height))
+        {
+            return false;
+        }
+
+        /* The views are moved to the workspace by laying out its tree */
+        transplant_node(group, vp);
+        return true;
+    }
+
+    wf::key_callback on_send_group = [=] (wf::keybinding_t binding)
+    {
+        if (binding == key_send_group_left)
+        {
+            return send_group_to_workspace(tile::INSERT_LEFT);
+        }
+        else if (binding == key_send_group_right)
+        {
+            return send_group_to_workspace(tile::INSERT_RIGHT);
+        }
+        else if (binding == key_send_group_above)
+        {
+            return send_group_to_workspace(tile::INSERT_ABOVE);
+        }
+        else if (binding == key_send_group_below)
+        {
+            return send_group_to_workspace(tile::INSERT_BELOW);
         }
 
         return false;
@@ -781,13 +1400,19 @@ class tile_plugin_t : public wf::plugin_interface_t
 
     wf::button_callback on_resize_view = [=] (auto)
     {
-        return start_controller<tile::resize_view_controller_t>();
+        return start_controller<tile::resize_view_controller_t>((bool)resize_preview);
+    };
+
+    wf::button_callback on_resize_view_preview = [=] (auto)
+    {
+        return start_controller<tile::resize_view_controller_t>(true);
     };
 
     void setup_callbacks()
     {
         output->add_button(button_move, &on_move_view);
         output->add_button(button_resize, &on_resize_view);
+        output->add_button(button_resize_preview, &on_resize_view_preview);
         output->add_key(key_toggle_tile, &on_toggle_tiled_state);
 
         output->add_key(key_toggle_split_direction, &on_toggle_split_direction);
@@ -805,6 +1430,11 @@ class tile_plugin_t : public wf::plugin_interface_t
         output->add_key(key_move_above, &on_move_adjacent);
         output->add_key(key_move_below, &on_move_adjacent);
 
+        output->add_key(key_send_group_left, &on_send_group);
+        output->add_key(key_send_group_right, &on_send_group);
+        output->add_key(key_send_group_above, &on_send_group);
+        output->add_key(key_send_group_below, &on_send_group);
+
         grab_interface->callbacks.pointer.button =
             [=] (uint32_t /*button*/, uint32_t state)
         {
@@ -819,9 +1449,9 @@ class tile_plugin_t : public wf::plugin_interface_t
             controller->input_motion(get_global_input_coordinates());
         };
 
-        inner_gaps.set_callback(update_gaps);
-        outer_horiz_gaps.set_callback(update_gaps);
-        outer_vert_gaps.set_callback(update_gaps);
+        inner_gaps.set_callback(schedule_update_gaps);
+        outer_horiz_gaps.set_callback(schedule_update_gaps);
+        outer_vert_gaps.set_callback(schedule_update_gaps);
         update_gaps();
     }
 
@@ -833,6 +1463,10 @@ class tile_plugin_t : public wf::plugin_interface_t
          * their own, and should be able to have more than one */
         this->grab_interface->capabilities = CAPABILITY_MANAGE_COMPOSITOR;
 
+        output->store_data(std::make_unique<wf::output_tiling_t>());
+        output->store_data(
+            std::make_unique<wf::tile::animation_scheduler_t>(output));
+
         resize_roots(output->wset()->get_workspace_grid_size());
         // TODO: check whether this was successful
         output->wset()->set_workspace_implementation(
@@ -842,9 +1476,14 @@ class tile_plugin_t : public wf::plugin_interface_t
         output->connect_signal("view-layer-attached", &on_view_attached);
         output->connect_signal("view-layer-detached", &on_view_detached);
         output->connect_signal("workarea-changed", &on_workarea_changed);
+        output->connect_signal("workspace-changed", &on_workspace_changed);
+        output->connect_signal("plugin-activation-state-changed",
+            &on_plugin_activation_changed);
+        output->connect_signal("view-focus-request", &on_focus_request);
         output->connect_signal("view-tile-request", &on_tile_request);
         output->connect_signal("view-fullscreen-request",
             &on_fullscreen_request);
+        output->connect_signal("view-fullscreen", &on_fullscreen_changed);
         output->connect_signal("view-focused", &on_focus_changed);
         output->connect_signal("view-change-workspace", &on_view_change_workspace);
         output->connect_signal("view-change-viewport", &on_view_change_workspace); /* For older wayfire versions. */
@@ -860,19 +1499,43 @@ class tile_plugin_t : public wf::plugin_interface_t
     void fini() override
     {
         output->wset()->set_workspace_implementation(nullptr, true);
+        output->erase_data<wf::output_tiling_t>();
 
-        for (auto& row : tiled_sublayer)
+        /* Finishes the running animations */
+        output->erase_data<wf::tile::animation_scheduler_t>();
+
+        if (workarea_hook_active)
         {
-            for (auto& sublayer : row)
+            output->render->rem_effect(&on_workarea_frame);
+        }
+
+        workarea_settle_timer.disconnect();
+
+        for (auto& col : roots)
+        {
+            for (auto& root : col)
+            {
+                tile::for_each_view(root, [&] (wayfire_toplevel_view view)
+                {
+                    view->erase_data<wf::view_fullscreen_counted_t>();
+                });
+            }
+        }
+
+        for (size_t i = 0; i < tiled_sublayer.size(); i++)
+        {
+            for (size_t j = 0; j < tiled_sublayer[i].size(); j++)
             {
-                output->wset()->destroy_sublayer(sublayer);
+                destroy_sublayer({(int)i, (int)j});
             }
         }
 
         output->rem_binding(&on_move_view);
         output->rem_binding(&on_resize_view);
+        output->rem_binding(&on_resize_view_preview);
         output->rem_binding(&on_toggle_tiled_state);
         output->rem_binding(&on_focus_adjacent);
+        output->rem_binding(&on_send_group);
     }
 };
 }
@@ -0,0 +1,13 @@
+#include "tile-stats.hpp"
+
+namespace wf
+{
+namespace tile
+{
+tile_stats_t& get_stats()
+{
+    static tile_stats_t stats;
+    return stats;
+}
+}
+}
@@ -0,0 +1,84 @@
+#ifndef WF_TILE_PLUGIN_STATS_HPP
+#define WF_TILE_PLUGIN_STATS_HPP
+
+#include <cstdint>
+
+namespace wf
+{
+namespace tile
+{
+/**
+ * Counters describing how much work the plugin does, shared by all outputs.
+ * They are exposed over IPC so that changes to the layout code can be
+ * verified on a running session.
+ */
+struct tile_stats_t
+{
+    /** Number of transactions scheduled by the plugin */
+    uint64_t transactions = 0;
+    /** Views which got a new geometry in a transaction */
+    uint64_t views_committed = 0;
+    /** Views which were laid out, but left out of the transaction because
+     * their geometry did not change */
+    uint64_t views_skipped = 0;
+
+    /** Resize motion events merged into a later frame's transaction */
+    uint64_t motions_coalesced = 0;
+
+    /** Layouts of whole trees which were restored from the layout cache */
+    uint64_t layouts_restored = 0;
+
+    /** Animations started for views which changed their geometry */
+    uint64_t animations_started = 0;
+    /** Views which slide instead of crossfading because the animation limit
+     * was reached, or because frames were too slow */
+    uint64_t animations_over_limit = 0;
+    uint64_t animations_slow_frames = 0;
+    /** Views resized without animation because they were not visible */
+    uint64_t animations_offscreen = 0;
+
+    /** Relayouts avoided by applying several option changes at once */
+    uint64_t relayouts_saved = 0;
+
+    /** Tiled sublayers which currently exist, on all outputs */
+    int64_t sublayers = 0;
+
+    /** Committed and skipped views of the last scheduled transaction */
+    uint32_t last_tx_committed = 0;
+    uint32_t last_tx_skipped   = 0;
+
+    /** Committed and skipped views of the transaction being built */
+    uint32_t pending_committed = 0;
+    uint32_t pending_skipped   = 0;
+
+    /** Record a view which was laid out by the layout pass */
+    void record_view(bool committed)
+    {
+        if (committed)
+        {
+            ++views_committed;
+            ++pending_committed;
+        } else
+        {
+            ++views_skipped;
+            ++pending_skipped;
+        }
+    }
+
+    /** Close the per-transaction counters, scheduled tells whether the
+     * transaction was actually scheduled or dropped because it was empty */
+    void record_transaction(bool scheduled)
+    {
+        transactions += scheduled;
+        last_tx_committed = pending_committed;
+        last_tx_skipped   = pending_skipped;
+        pending_committed = pending_skipped = 0;
+    }
+};
+
+/** Get the global statistics */
+tile_stats_t& get_stats();
+}
+}
+
+#endif /* end of include guard: WF_TILE_PLUGIN_STATS_HPP */
@@ -0,0 +1,86 @@
+#ifndef WF_TILE_PLUGIN_TILED_VIEW_HPP
+#define WF_TILE_PLUGIN_TILED_VIEW_HPP
+
+#include <cstdint>
+#include <wayfire/geometry.hpp>
+#include <wayfire/nonstd/observer_ptr.h>
+
+/*
+ * The interface between the tiling tree and the views it manages.
+ *
+ * The tree itself only does layout math. Everything which needs a running
+ * compositor, i.e configuring clients, animations and transformers, is done
+ * by the implementations of these interfaces. The plugin implements them on
+ * top of wayfire views and transactions, the headless backend implements them
+ * in-process so that the tree can run without a display.
+ */
+namespace wf
+{
+namespace tile
+{
+struct view_node_t;
+
+struct gap_size_t
+{
+    /* Gap on the left side */
+    int32_t left = 0;
+    /* Gap on the right side */
+    int32_t right = 0;
+    /* Gap on the top side */
+    int32_t top = 0;
+    /* Gap on the bottom side */
+    int32_t bottom = 0;
+    /* Gap for internal splits */
+    int32_t internal = 0;
+};
+
+/**
+ * A batch of view geometry changes produced by one layout pass. Backends
+ * derive from it to carry their own transaction type.
+ */
+class layout_transaction_t
+{
+  public:
+    virtual ~layout_transaction_t() = default;
+
+    /** Number of views which were configured as part of the transaction */
+    uint32_t num_views = 0;
+};
+
+/**
+ * The view contained in a view_node_t.
+ */
+class tiled_view_t
+{
+  public:
+    virtual ~tiled_view_t() = default;
+
+    /** The node which contains the view, set by the node itself */
+    nonstd::observer_ptr<view_node_t> node;
+
+    /** Whether the view is mapped and can be configured */
+    virtual bool is_mapped() = 0;
+
+    /**
+     * Calculate the geometry the view should get when its node occupies
+     * node_geometry, with the given gaps around it.
+     */
+    virtual wf::geometry_t calculate_target_geometry(
+        wf::geometry_t node_geometry, const gap_size_t& gaps) = 0;
+
+    /** Check whether the view already has or is about to get the geometry */
+    virtual bool has_pending_geometry(wf::geometry_t target) = 0;
+
+    /** Set the geometry of the view as part of the given transaction */
+    virtual void configure(wf::geometry_t target, layout_transaction_t& tx) = 0;
+
+    /**
+     * Show the view at the given geometry without configuring it, e.g. by
+     * scaling its current contents.
+     */
+    virtual void preview(wf::geometry_t target) = 0;
+};
+}
+}
+
+#endif /* end of include guard: WF_TILE_PLUGIN_TILED_VIEW_HPP */
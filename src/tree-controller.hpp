@@ -2,7 +2,11 @@
 #define WF_TILE_PLUGIN_TREE_CONTROLLER_HPP
 
 #include "tree.hpp"
+#include "tree-search.hpp"
+#include "pair-resize.hpp"
+#include "wayfire-view.hpp"
 #include <wayfire/option-wrapper.hpp>
+#include <wayfire/render-manager.hpp>
 
 /* Contains functions which are related to manipulating the tiling tree */
 namespace wf
@@ -16,27 +20,11 @@ namespace tile
 void for_each_view(nonstd::observer_ptr<tree_node_t> root,
     std::function<void(wayfire_toplevel_view)> callback);
 
-enum split_insertion_t
-{
-    /** Insert is invalid */
-    INSERT_NONE  = 0,
-    /** Insert above the view */
-    INSERT_ABOVE = 1,
-    /** Insert below the view */
-    INSERT_BELOW = 2,
-    /** Insert to the left of the view */
-    INSERT_LEFT  = 3,
-    /** Insert to the right of the view */
-    INSERT_RIGHT = 4,
-    /** Insert by swapping with the source view */
-    INSERT_SWAP  = 5,
-};
-
 /**
- * Find the first view in the indicated direction
+ * Schedule a transaction built by the layout pass, unless no view in it
+ * changed.
  */
-nonstd::observer_ptr<view_node_t> find_first_view_in_direction(
-    nonstd::observer_ptr<tree_node_t> from, split_insertion_t direction);
+void schedule_layout_transaction(wayfire_transaction_t& tx);
 
 /**
  * Represents the current mode in which the tile plugin is.
@@ -115,18 +103,46 @@ class resize_view_controller_t : public tile_controller_t
      * @param root The root of the tiling tree which is currently being
      *             manipulated
      * @param Where the grab has started
+     * @param preview Whether to only scale the views while dragging, and
+     *                send them their new size when the input is released
      */
     resize_view_controller_t(std::unique_ptr<tree_node_t>& root,
-        wf::point_t grab);
+        wf::point_t grab, bool preview = false);
     ~resize_view_controller_t();
 
     void input_motion(wf::point_t input) override;
+    void input_released() override;
 
   protected:
     std::unique_ptr<tree_node_t>& root;
+    wf::output_t *output = nullptr;
+    bool preview;
 
-    /** Last input event location */
-    wf::point_t last_point;
+    /** Latest input event location, committed on the next frame */
+    wf::point_t pending_point;
+
+    /**
+     * Motion events are coalesced: only the latest input position is stored
+     * and it is committed right before the output renders its next frame, so
+     * that at most one transaction per frame is scheduled.
+     */
+    bool frame_hook_active = false;
+    wf::effect_hook_t on_frame = [=] () { commit_pending_motion(false); };
+
+    /** Send the views a new configure only once they acked the previous one */
+    wf::option_wrapper_t<bool> wait_for_ack{"better-tiling/resize_wait_for_ack"};
+    /** Whether the last scheduled transaction is not applied yet */
+    bool waiting_for_ack = false;
+    wf::signal::connection_t<wf::txn::transaction_applied_signal> on_transaction_applied;
+
+    /**
+     * Resize the pairs to the pending input position and schedule the
+     * transaction, or only preview the new layout in preview mode.
+     *
+     * @param force Commit even if the previous transaction is still pending,
+     *              and also in preview mode
+     */
+    void commit_pending_motion(bool force);
 
     /** Edges of the grabbed view that we're resizing */
     uint32_t resizing_edges;
@@ -136,17 +152,8 @@ class resize_view_controller_t : public tile_controller_t
     /** The view we are resizing */
     nonstd::observer_ptr<view_node_t> grabbed_view;
 
-    /*
-     * A resizing pair of nodes is a pair of nodes we need to resize
-     * The first one is always to the left/above the second one.
-     */
-    using resizing_pair_t = std::pair<nonstd::observer_ptr<tree_node_t>,
-        nonstd::observer_ptr<tree_node_t>>;
-
-    /** The horizontally-aligned pair we're resizing */
-    resizing_pair_t horizontal_pair;
-    /** The vertically-aligned pair we're resizing */
-    resizing_pair_t vertical_pair;
+    /** The resizing pairs and their geometries */
+    pair_resize_t resize;
 
     /*
      * Find a resizing pair in the given direction.
@@ -155,19 +162,6 @@ class resize_view_controller_t : public tile_controller_t
      * resizing edges.
      */
     resizing_pair_t find_resizing_pair(bool horizontal);
-
-    /**
-     * Adjust the given positions and sizes while resizing.
-     *
-     * @param x1 The start of the first geometry
-     * @param len1 The dimension of the first geometry
-     * @param x2 The start of the second geometry, should be x1 + len1
-     * @param len2 The length of the second geometry
-     *
-     * @param delta How much change to apply
-     */
-    void adjust_geometry(int32_t& x1, int32_t& len1,
-        int32_t& x2, int32_t& len2, int32_t delta);
 };
 }
 }
@@ -0,0 +1,398 @@
+#include "tree-search.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <cassert>
+
+namespace wf
+{
+namespace tile
+{
+nonstd::observer_ptr<view_node_t> find_view_at(
+    nonstd::observer_ptr<tree_node_t> root, wf::point_t input)
+{
+    /* Whole trees which are laid out are looked up in the index of the tree,
+     * anything else is searched by walking down from the node. */
+    if (root->arena && !root->get_parent() && root->as_split_node() &&
+        !root->arena->slots[root->slot].flags)
+    {
+        auto& index = root->arena->leaf_index;
+        if (index.generation != root->arena->generation)
+        {
+            index.build(root.get());
+        }
+
+        return nonstd::make_observer(index.find(input));
+    }
+
+    if (root->as_view_node())
+    {
+        return root->as_view_node();
+    }
+
+    for (auto child : root->get_children())
+    {
+        if (child->geometry & input)
+        {
+            return find_view_at(child, input);
+        }
+    }
+
+    /* Children probably empty? */
+    return nullptr;
+}
+
+/**
+ * Calculate the position of the split that needs to be created if a view is
+ * dropped at @input over @node
+ *
+ * @param sensitivity What percentage of the view is "active", i.e the threshold
+ *                    for INSERT_NONE
+ */
+static split_insertion_t calculate_insert_type(
+    nonstd::observer_ptr<tree_node_t> node, wf::point_t input, double sensitivity)
+{
+    auto window = node->geometry;
+
+    if (!(window & input))
+    {
+        return INSERT_NONE;
+    }
+
+    /*
+     * Calculate how much to the left, right, top and bottom of the window
+     * our input is, then filter through the sensitivity.
+     *
+     * In the end, take the edge which is closest to input. Ties go to the
+     * edge with the lowest split_insertion_t value.
+     */
+    double px = 1.0 * (input.x - window.x) / window.width;
+    double py = 1.0 * (input.y - window.y) / window.height;
+
+    const std::pair<double, split_insertion_t> edges[] = {
+        {px, INSERT_LEFT},
+        {py, INSERT_ABOVE},
+        {1.0 - px, INSERT_RIGHT},
+        {1.0 - py, INSERT_BELOW},
+    };
+
+    auto closest = INSERT_SWAP;
+    double closest_distance = sensitivity;
+    for (auto& [distance, type] : edges)
+    {
+        /* Edges that are too far away are never picked */
+        if ((distance < closest_distance) ||
+            ((distance == closest_distance) && (type < closest)))
+        {
+            closest = type;
+            closest_distance = distance;
+        }
+    }
+
+    return closest;
+}
+
+/* By default, 1/3rd of the view can be dropped into */
+static constexpr double SPLIT_PREVIEW_PERCENTAGE = 1.0 / 3.0;
+
+split_insertion_t calculate_insert_type(
+    nonstd::observer_ptr<tree_node_t> node, wf::point_t input)
+{
+    return calculate_insert_type(node, input, SPLIT_PREVIEW_PERCENTAGE);
+}
+
+wf::geometry_t calculate_split_preview(nonstd::observer_ptr<tree_node_t> over,
+    split_insertion_t split_type)
+{
+    auto preview = over->geometry;
+    switch (split_type)
+    {
+      case INSERT_RIGHT:
+        preview.x += preview.width * (1 - SPLIT_PREVIEW_PERCENTAGE);
+
+      // fallthrough
+      case INSERT_LEFT:
+        preview.width = preview.width * SPLIT_PREVIEW_PERCENTAGE;
+        break;
+
+      case INSERT_BELOW:
+        preview.y += preview.height * (1 - SPLIT_PREVIEW_PERCENTAGE);
+
+      // fallthrough
+      case INSERT_ABOVE:
+        preview.height = preview.height * SPLIT_PREVIEW_PERCENTAGE;
+        break;
+
+      default:
+        break; // nothing to do
+    }
+
+    return preview;
+}
+
+/** Get the up to date adjacency graph of the arena the node is in */
+static const adjacency_graph_t& get_adjacency(tree_node_t *node)
+{
+    auto& arena = *node->arena;
+    if (arena.adjacency.generation != arena.topology_generation)
+    {
+        arena.adjacency.build(arena);
+    }
+
+    return arena.adjacency;
+}
+
+static adjacency_graph_t::direction_t to_adjacency_direction(
+    split_insertion_t direction)
+{
+    switch (direction)
+    {
+      case INSERT_LEFT:
+        return adjacency_graph_t::LEFT;
+
+      case INSERT_RIGHT:
+        return adjacency_graph_t::RIGHT;
+
+      case INSERT_ABOVE:
+        return adjacency_graph_t::ABOVE;
+
+      case INSERT_BELOW:
+        return adjacency_graph_t::BELOW;
+
+      default:
+        assert(false);
+        return adjacency_graph_t::LEFT;
+    }
+}
+
+static split_position_t to_split_position(const tree_arena_t& arena,
+    adjacency_graph_t::link_t link)
+{
+    if (link.split == tree_arena_t::NIL)
+    {
+        return {};
+    }
+
+    auto split = static_cast<split_node_t*>(arena.slots[link.split].node);
+    return {nonstd::make_observer(split), link.index};
+}
+
+split_position_t find_adjacent(nonstd::observer_ptr<tree_node_t> node,
+    split_insertion_t direction)
+{
+    if (!node->arena)
+    {
+        return {};
+    }
+
+    auto& graph = get_adjacency(node.get());
+    return to_split_position(*node->arena,
+        graph.neighbour(node->slot, to_adjacency_direction(direction)));
+}
+
+split_position_t find_split_ancestor(nonstd::observer_ptr<tree_node_t> node,
+    split_insertion_t direction)
+{
+    if (!node->arena)
+    {
+        return {};
+    }
+
+    auto& graph = get_adjacency(node.get());
+    return to_split_position(*node->arena,
+        graph.split_ancestor(node->slot, to_adjacency_direction(direction)));
+}
+
+/** The point just outside of the edge of window in the given direction */
+static wf::point_t get_point_in_direction(wf::geometry_t window,
+    split_insertion_t direction)
+{
+    wf::point_t point = {0, 0};
+    switch (direction)
+    {
+      case INSERT_ABOVE:
+        point = {
+            window.x + window.width / 2,
+            window.y - 1,
+        };
+        break;
+
+      case INSERT_BELOW:
+        point = {
+            window.x + window.width / 2,
+            window.y + window.height,
+        };
+        break;
+
+      case INSERT_LEFT:
+        point = {
+            window.x - 1,
+            window.y + window.height / 2,
+        };
+        break;
+
+      case INSERT_RIGHT:
+        point = {
+            window.x + window.width,
+            window.y + window.height / 2,
+        };
+        break;
+
+      default:
+        assert(false);
+    }
+
+    return point;
+}
+
+/**
+ * Check whether find_view_at() on the root finds a view in the subtree of
+ * node, without building the leaf index. This walks the path of the node and
+ * the siblings along it, like the lookup on a tree without an index does.
+ */
+static bool has_view_at(nonstd::observer_ptr<tree_node_t> node, wf::point_t point)
+{
+    for (auto current = node; current->get_parent();
+         current = current->get_parent())
+    {
+        if (!(current->geometry & point))
+        {
+            return false;
+        }
+
+        /* An earlier sibling containing the point takes precedence. Only
+         * the children of tabbed splits overlap, the others tile their
+         * parent. */
+        if (!current->get_parent()->is_tabbed())
+        {
+            continue;
+        }
+
+        for (auto sibling : current->get_parent()->get_children())
+        {
+            if (sibling == current)
+            {
+                break;
+            }
+
+            if (sibling->geometry & point)
+            {
+                return false;
+            }
+        }
+    }
+
+    while (!node->as_view_node())
+    {
+        nonstd::observer_ptr<tree_node_t> next = nullptr;
+        for (auto child : node->get_children())
+        {
+            if (child->geometry & point)
+            {
+                next = child;
+                break;
+            }
+        }
+
+        if (!next)
+        {
+            return false;
+        }
+
+        node = next;
+    }
+
+    return true;
+}
+
+nonstd::observer_ptr<view_node_t> find_first_view_in_direction(
+    nonstd::observer_ptr<tree_node_t> from, split_insertion_t direction)
+{
+    /* Since nodes are arranged tightly into a grid, we can just find the
+     * proper edge and find the view there */
+    return find_view_at(get_root(from),
+        get_point_in_direction(from->geometry, direction));
+}
+
+nonstd::observer_ptr<split_node_t> find_common_ancestor(
+    nonstd::observer_ptr<tree_node_t> a, nonstd::observer_ptr<tree_node_t> b,
+    nonstd::observer_ptr<tree_node_t>& a_child,
+    nonstd::observer_ptr<tree_node_t>& b_child)
+{
+    assert(a->arena == b->arena);
+    auto& slots = a->arena->slots;
+    int32_t x = a->slot, y = b->slot;
+
+    /* Bring both to the same depth, then climb together until they meet */
+    while (slots[x].depth > slots[y].depth)
+    {
+        x = slots[x].parent;
+    }
+
+    while (slots[y].depth > slots[x].depth)
+    {
+        y = slots[y].parent;
+    }
+
+    assert(x != y);
+    while (slots[x].parent != slots[y].parent)
+    {
+        x = slots[x].parent;
+        y = slots[y].parent;
+    }
+
+    a_child = nonstd::make_observer(slots[x].node);
+    b_child = nonstd::make_observer(slots[y].node);
+    return a_child->get_parent();
+}
+
+resizing_pair_t find_resizing_pair(nonstd::observer_ptr<view_node_t> view,
+    split_insertion_t direction)
+{
+    assert(direction >= INSERT_ABOVE && direction <= INSERT_RIGHT);
+    auto& cache = view->resizing_pairs[direction - INSERT_ABOVE];
+    if (view->arena && (cache.arena_id == view->arena->id) &&
+        (cache.topology_generation == view->arena->topology_generation))
+    {
+        /* The pair is found through the view at the edge of the view, which
+         * depends on the geometries: it is the same as long as that view is
+         * still in the other node of the pair. */
+        bool forward = (direction == INSERT_BELOW) || (direction == INSERT_RIGHT);
+        auto other   = forward ? cache.second : cache.first;
+        if (has_view_at(other, get_point_in_direction(view->geometry, direction)))
+        {
+            return {cache.first, cache.second};
+        }
+    }
+
+    /* Find a view in the resizing direction, then look for the least common
+     * ancestor(LCA) of the view and the found view.
+     *
+     * Then the resizing pair is a pair of children of the LCA */
+    resizing_pair_t result_pair = {nullptr, view};
+    if (auto pair_view = find_first_view_in_direction(view, direction))
+    {
+        find_common_ancestor(view, pair_view, result_pair.first, result_pair.second);
+
+        /* Make sure the first node in the resizing pair is always to the
+         * left or above of the second one */
+        if ((direction == INSERT_LEFT) || (direction == INSERT_ABOVE))
+        {
+            std::swap(result_pair.first, result_pair.second);
+        }
+    }
+
+    /* A pair which was not found, e.g. because the tree was not laid out
+     * yet, is not stored, so that a stale miss can never be served */
+    if (view->arena && result_pair.first)
+    {
+        cache.arena_id = view->arena->id;
+        cache.topology_generation = view->arena->topology_generation;
+        cache.first  = result_pair.first;
+        cache.second = result_pair.second;
+    }
+
+    return result_pair;
+}
+}
+}
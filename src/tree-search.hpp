@@ -0,0 +1,113 @@
+#ifndef WF_TILE_PLUGIN_TREE_SEARCH_HPP
+#define WF_TILE_PLUGIN_TREE_SEARCH_HPP
+
+#include "tree.hpp"
+
+/* Contains geometric queries on the tiling tree */
+namespace wf
+{
+namespace tile
+{
+enum split_insertion_t
+{
+    /** Insert is invalid */
+    INSERT_NONE  = 0,
+    /** Insert above the view */
+    INSERT_ABOVE = 1,
+    /** Insert below the view */
+    INSERT_BELOW = 2,
+    /** Insert to the left of the view */
+    INSERT_LEFT  = 3,
+    /** Insert to the right of the view */
+    INSERT_RIGHT = 4,
+    /** Insert by swapping with the source view */
+    INSERT_SWAP  = 5,
+};
+
+/**
+ * Calculate which view node is at the given position
+ *
+ * Lookups on the root of a laid out tree use a spatial index of the leaves,
+ * which is rebuilt only after the tree changes.
+ *
+ * Returns null if no view nodes are present.
+ */
+nonstd::observer_ptr<view_node_t> find_view_at(
+    nonstd::observer_ptr<tree_node_t> root, wf::point_t input);
+
+/**
+ * Calculate the position of the split that needs to be created if a view is
+ * dropped at @input over @node
+ */
+split_insertion_t calculate_insert_type(
+    nonstd::observer_ptr<tree_node_t> node, wf::point_t input);
+
+/**
+ * Calculate the bounds of the split preview
+ */
+wf::geometry_t calculate_split_preview(nonstd::observer_ptr<tree_node_t> over,
+    split_insertion_t split_type);
+
+/**
+ * A position in a split, i.e a child index.
+ */
+struct split_position_t
+{
+    nonstd::observer_ptr<split_node_t> split;
+    int index = -1;
+};
+
+/**
+ * Find the closest sibling in the given direction, of the node itself or of
+ * its closest ancestor which has one. The split is nullptr if there is none.
+ */
+split_position_t find_adjacent(nonstd::observer_ptr<tree_node_t> node,
+    split_insertion_t direction);
+
+/**
+ * Find the closest ancestor of the node which splits along the axis of the
+ * given direction, and the index of the child through which the node is
+ * reached. The split is nullptr if there is none.
+ */
+split_position_t find_split_ancestor(nonstd::observer_ptr<tree_node_t> node,
+    split_insertion_t direction);
+
+/**
+ * Find the first view in the indicated direction
+ */
+nonstd::observer_ptr<view_node_t> find_first_view_in_direction(
+    nonstd::observer_ptr<tree_node_t> from, split_insertion_t direction);
+
+/**
+ * Find the lowest common ancestor of two different nodes of the same tree,
+ * neither of which may be an ancestor of the other.
+ *
+ * @param a_child Set to the child of the ancestor on the path to a
+ * @param b_child Set to the child of the ancestor on the path to b
+ */
+nonstd::observer_ptr<split_node_t> find_common_ancestor(
+    nonstd::observer_ptr<tree_node_t> a, nonstd::observer_ptr<tree_node_t> b,
+    nonstd::observer_ptr<tree_node_t>& a_child,
+    nonstd::observer_ptr<tree_node_t>& b_child);
+
+/*
+ * A resizing pair of nodes is a pair of nodes we need to resize
+ * The first one is always to the left/above the second one.
+ */
+using resizing_pair_t = std::pair<nonstd::observer_ptr<tree_node_t>,
+    nonstd::observer_ptr<tree_node_t>>;
+
+/**
+ * Find the pair of nodes whose common edge moves when the edge of the view
+ * in the given direction is dragged. If there is no such edge, the first node
+ * is nullptr.
+ *
+ * Pairs are cached in the view node until the topology of the tree changes,
+ * or the geometries change so that the view has another neighbour.
+ */
+resizing_pair_t find_resizing_pair(nonstd::observer_ptr<view_node_t> view,
+    split_insertion_t direction);
+}
+}
+
+#endif /* end of include guard: WF_TILE_PLUGIN_TREE_SEARCH_HPP */
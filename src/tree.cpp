@@ -1,62 +1,353 @@
 #include "tree.hpp"
+#include "tile-stats.hpp"
 
-#include <iostream>
 #include <algorithm>
-
-#include <wayfire/util.hpp>
-#include <wayfire/util/log.hpp>
-#include <wayfire/output.hpp>
-#include <wayfire/view-transform.hpp>
-#include <wayfire/view-helpers.hpp>
-#include <wayfire/workspace-set.hpp>
-#include <wayfire/plugins/crossfade.hpp>
-// #include "crossfade.hpp"
-
+#include <cassert>
 
 namespace wf
 {
 namespace tile
 {
-void tree_node_t::set_geometry(wf::geometry_t geometry, wf::txn::transaction_uptr&)
+/* ----------------------- tree_arena_t implementation ---------------------- */
+static uint64_t next_arena_id()
+{
+    static uint64_t last_id = 0;
+    return ++last_id;
+}
+
+tree_arena_t::tree_arena_t() : id(next_arena_id())
+{}
+
+int32_t tree_arena_t::allocate(tree_node_t *node, node_kind_t kind)
+{
+    int32_t idx;
+    if (free_slots.empty())
+    {
+        idx = slots.size();
+        slots.emplace_back();
+    } else
+    {
+        idx = free_slots.back();
+        free_slots.pop_back();
+    }
+
+    slots[idx] = slot_t{};
+    slots[idx].node = node;
+    slots[idx].kind = kind;
+    return idx;
+}
+
+void tree_arena_t::release(int32_t idx)
+{
+    assert(slots[idx].parent == NIL && slots[idx].num_children == 0);
+    slots[idx].node = nullptr;
+    free_slots.push_back(idx);
+}
+
+void tree_arena_t::link(int32_t parent, int32_t child, int32_t before)
+{
+    auto& p = slots[parent];
+    auto& c = slots[child];
+    assert(c.parent == NIL);
+
+    topology_changed();
+    ++link_generation;
+    c.parent = parent;
+    c.next_sibling = before;
+    if (before == NIL)
+    {
+        c.prev_sibling = p.last_child;
+        p.last_child   = child;
+    } else
+    {
+        assert(slots[before].parent == parent);
+        c.prev_sibling = slots[before].prev_sibling;
+        slots[before].prev_sibling = child;
+    }
+
+    if (c.prev_sibling == NIL)
+    {
+        p.first_child = child;
+    } else
+    {
+        slots[c.prev_sibling].next_sibling = child;
+    }
+
+    ++p.num_children;
+    renumber(child, (c.prev_sibling == NIL) ? 0 : slots[c.prev_sibling].sibling_index + 1);
+    set_depth(child, p.depth + 1);
+}
+
+void tree_arena_t::unlink(int32_t child)
+{
+    auto& c = slots[child];
+    if (c.parent == NIL)
+    {
+        return;
+    }
+
+    topology_changed();
+    ++link_generation;
+    auto& p = slots[c.parent];
+    if (c.prev_sibling == NIL)
+    {
+        p.first_child = c.next_sibling;
+    } else
+    {
+        slots[c.prev_sibling].next_sibling = c.next_sibling;
+    }
+
+    if (c.next_sibling == NIL)
+    {
+        p.last_child = c.prev_sibling;
+    } else
+    {
+        slots[c.next_sibling].prev_sibling = c.prev_sibling;
+    }
+
+    --p.num_children;
+    renumber(c.next_sibling, c.sibling_index);
+    c.parent = c.next_sibling = c.prev_sibling = NIL;
+    c.sibling_index = 0;
+    set_depth(child, 0);
+}
+
+void tree_arena_t::renumber(int32_t first, int32_t index)
+{
+    for (int32_t idx = first; idx != NIL; idx = slots[idx].next_sibling)
+    {
+        slots[idx].sibling_index = index++;
+    }
+}
+
+void tree_arena_t::set_depth(int32_t idx, int32_t depth)
+{
+    if (slots[idx].depth == depth)
+    {
+        return;
+    }
+
+    slots[idx].depth = depth;
+    for (int32_t child = slots[idx].first_child; child != NIL;
+         child = slots[child].next_sibling)
+    {
+        set_depth(child, depth + 1);
+    }
+}
+
+void tree_arena_t::swap(int32_t a, int32_t b)
+{
+    if (a == b)
+    {
+        return;
+    }
+
+    int32_t pa = slots[a].parent, na = slots[a].next_sibling;
+    int32_t pb = slots[b].parent, nb = slots[b].next_sibling;
+
+    /* Adjacent siblings: just move the second one before the first */
+    if (na == b)
+    {
+        unlink(b);
+        link(pa, b, a);
+        return;
+    }
+
+    if (nb == a)
+    {
+        unlink(a);
+        link(pb, a, b);
+        return;
+    }
+
+    unlink(a);
+    unlink(b);
+    link(pb, a, nb);
+    link(pa, b, na);
+}
+
+void tree_arena_t::adopt(tree_node_t *node)
+{
+    auto old_arena = node->arena;
+    int32_t old_slot = node->slot;
+    if (old_arena.get() == this)
+    {
+        return;
+    }
+
+    /* The local reference keeps the old arena alive until we are done */
+    node->arena = shared_from_this();
+    node->slot  = allocate(node, node->kind);
+    int32_t new_slot = node->slot;
+
+    if (old_arena)
+    {
+        slots[new_slot].flags = old_arena->slots[old_slot].flags;
+        assert(old_arena->slots[old_slot].parent == NIL);
+        int32_t child = old_arena->slots[old_slot].first_child;
+        while (child != NIL)
+        {
+            /* Adopting the child releases its old slot, so advance first. The
+             * whole subtree moves, so the remaining siblings do not need to be
+             * renumbered. */
+            auto& old = old_arena->slots[child];
+            int32_t next = old.next_sibling;
+            auto child_node = old.node;
+            old.parent = old.next_sibling = old.prev_sibling = NIL;
+
+            adopt(child_node);
+            link(new_slot, child_node->slot);
+            child = next;
+        }
+
+        auto& old = old_arena->slots[old_slot];
+        old.first_child  = old.last_child = NIL;
+        old.num_children = 0;
+        old_arena->topology_changed();
+        ++old_arena->link_generation;
+        old_arena->release(old_slot);
+    }
+}
+
+child_range_t::iterator child_range_t::begin() const
+{
+    return {arena, arena ? arena->slots[parent].first_child : tree_arena_t::NIL};
+}
+
+child_range_t::iterator child_range_t::end() const
+{
+    return {arena, tree_arena_t::NIL};
+}
+
+size_t child_range_t::size() const
+{
+    return arena ? arena->slots[parent].num_children : 0;
+}
+
+bool child_range_t::empty() const
+{
+    return size() == 0;
+}
+
+nonstd::observer_ptr<tree_node_t> child_range_t::front() const
+{
+    return nonstd::make_observer(arena->slots[arena->slots[parent].first_child].node);
+}
+
+nonstd::observer_ptr<tree_node_t> child_range_t::back() const
+{
+    return nonstd::make_observer(arena->slots[arena->slots[parent].last_child].node);
+}
+
+/* ----------------------- tree_node_t implementation ----------------------- */
+tree_node_t::tree_node_t(node_kind_t kind) : kind(kind)
+{}
+
+tree_node_t::~tree_node_t()
+{
+    if (arena)
+    {
+        arena->unlink(slot);
+        arena->release(slot);
+    }
+}
+
+void tree_node_t::set_geometry(wf::geometry_t geometry)
+{
+    if (this->geometry != geometry)
+    {
+        this->geometry = geometry;
+        if (arena)
+        {
+            ++arena->generation;
+            if (!arena->in_layout && (arena->slots[slot].parent != tree_arena_t::NIL))
+            {
+                ++arena->edit_generation;
+            }
+        }
+
+        mark_dirty();
+    }
+}
+
+void tree_node_t::mark_dirty()
+{
+    if (!arena)
+    {
+        /* Not part of any tree yet, adding it to one marks it dirty */
+        return;
+    }
+
+    arena->slots[slot].flags |= tree_arena_t::LAYOUT_DIRTY;
+    for (int32_t idx = arena->slots[slot].parent; idx != tree_arena_t::NIL;
+         idx = arena->slots[idx].parent)
+    {
+        auto& flags = arena->slots[idx].flags;
+        if (flags & tree_arena_t::LAYOUT_CHILD_DIRTY)
+        {
+            break;
+        }
+
+        flags |= tree_arena_t::LAYOUT_CHILD_DIRTY;
+    }
+}
+
+nonstd::observer_ptr<split_node_t> tree_node_t::get_parent() const
+{
+    if (!arena || (arena->slots[slot].parent == tree_arena_t::NIL))
+    {
+        return nullptr;
+    }
+
+    auto parent = arena->slots[arena->slots[slot].parent].node;
+    return nonstd::make_observer(static_cast<split_node_t*>(parent));
+}
+
+child_range_t tree_node_t::get_children() const
 {
-    this->geometry = geometry;
+    return {arena.get(), slot};
 }
 
 nonstd::observer_ptr<split_node_t> tree_node_t::as_split_node()
 {
-    return nonstd::make_observer(dynamic_cast<split_node_t*>(this));
+    if (kind != NODE_SPLIT)
+    {
+        return nullptr;
+    }
+
+    return nonstd::make_observer(static_cast<split_node_t*>(this));
 }
 
 nonstd::observer_ptr<view_node_t> tree_node_t::as_view_node()
 {
-    return nonstd::make_observer(dynamic_cast<view_node_t*>(this));
+    if (kind != NODE_VIEW)
+    {
+        return nullptr;
+    }
+
+    return nonstd::make_observer(static_cast<view_node_t*>(this));
 }
 
-int tree_node_t::get_sibling_index()
+int tree_node_t::get_sibling_index() const
 {
-    auto& children = this->parent->children;
-    auto it = std::find_if(children.begin(), children.end(),
-        [=] (auto& node) { return node.get() == this; });
-
-    return it - children.begin();
+    return arena ? arena->slots[slot].sibling_index : 0;
 }
 
-wf::point_t get_wset_local_coordinates(std::shared_ptr<wf::workspace_set_t> wset, wf::point_t p)
+path_range_t tree_node_t::get_path() const
 {
-    auto vp   = wset->get_current_workspace();
-    auto size = wset->get_last_output_geometry().value_or(default_output_resolution);
-    p.x -= vp.x * size.width;
-    p.y -= vp.y * size.height;
-    return p;
+    return {arena.get(), arena ? slot : tree_arena_t::NIL};
 }
 
-wf::geometry_t get_wset_local_coordinates(std::shared_ptr<wf::workspace_set_t> wset, wf::geometry_t g)
+int tree_node_t::get_depth() const
 {
-    auto new_tl = get_wset_local_coordinates(wset, wf::point_t{g.x, g.y});
-    g.x = new_tl.x;
-    g.y = new_tl.y;
+    return arena ? arena->slots[slot].depth : 0;
+}
 
-    return g;
+void swap_nodes(nonstd::observer_ptr<tree_node_t> a,
+    nonstd::observer_ptr<tree_node_t> b)
+{
+    assert(a->arena == b->arena);
+    a->arena->swap(a->slot, b->slot);
 }
 
 /* ---------------------- split_node_t implementation ----------------------- */
@@ -99,26 +390,26 @@ int32_t split_node_t::calculate_splittable() const
     return calculate_splittable(this->geometry);
 }
 
-void split_node_t::recalculate_children(wf::geometry_t available, wf::txn::transaction_uptr& tx)
+void split_node_t::recalculate_children(wf::geometry_t available)
 {
-    if (this->children.empty())
+    if (get_children().empty())
     {
         return;
     }
 
     if (this->tabbed)
     {
-        for (auto& child : this->children)
+        for (auto child : get_children())
         {
-            child->set_gaps(this->gaps, tx);
-            child->set_geometry(this->geometry, tx);
+            child->set_gaps(this->gaps);
+            child->set_geometry(this->geometry);
         }
 
         return;
     }
 
     double old_child_sum = 0.0;
-    for (auto& child : this->children)
+    for (auto child : get_children())
     {
         old_child_sum += calculate_splittable(child->geometry);
     }
@@ -128,49 +419,68 @@ void split_node_t::recalculate_children(wf::geometry_t available, wf::txn::trans
     /* Sum of children sizes up to now */
     double up_to_now = 0.0;
 
+    /* Children of a subtree which was built before being attached to a tree
+     * have no size yet, share the space equally between them. */
+    bool equal_split = (old_child_sum <= 0.0);
+    if (equal_split)
+    {
+        old_child_sum = get_children().size();
+    }
+
     auto progress = [=] (double current)
     {
         return (current / old_child_sum) * total_splittable;
     };
 
-    set_gaps(this->gaps, tx);
-
-    /* For each child, assign its percentage of the whole. */
-    for (auto& child : this->children)
+    /* For each child, assign its percentage of the whole, and its gaps in
+     * the same pass. */
+    int32_t index = 0;
+    int32_t last  = get_children().size() - 1;
+    for (auto child : get_children())
     {
+        child->set_gaps(calculate_child_gaps(index == 0, index == last));
+        ++index;
+
         /* Calculate child_start/end every time using the percentage from the
          * beginning. This way we avoid rounding errors causing empty spaces */
         int32_t child_start = progress(up_to_now);
-        up_to_now += calculate_splittable(child->geometry);
+        up_to_now += equal_split ? 1 : calculate_splittable(child->geometry);
         int32_t child_end = progress(up_to_now);
 
         /* Set new size */
         int32_t child_size = child_end - child_start;
-        child->set_geometry(get_child_geometry(child_start, child_size), tx);
+        child->set_geometry(get_child_geometry(child_start, child_size));
     }
 }
 
-void split_node_t::add_child(std::unique_ptr<tree_node_t> child, wf::txn::transaction_uptr& tx, int index)
+void split_node_t::add_child(std::unique_ptr<tree_node_t> child, int index)
 {
-
     /*
     * Strategy:
     * Calculate the size of the new child relative to the old children, so
     * that proportions are right. After that, rescale all nodes.
     */
-    int num_children = this->children.size();
+    ensure_arena();
+    int num_children = get_children().size();
 
     if ((index == -1) || (index > num_children))
     {
         index = num_children;
     }
 
-    /* Calculate where the new child should be, in current proportions */
+    /* Calculate where the new child should be, in current proportions. The
+     * children may not have been laid out since the last addition, so use
+     * their recorded sizes instead of the size of the node. */
     int size_new_child;
     if (num_children > 0)
     {
-        size_new_child =
-            (calculate_splittable() + num_children - 1) / num_children;
+        int32_t children_sum = 0;
+        for (auto sibling : get_children())
+        {
+            children_sum += calculate_splittable(sibling->geometry);
+        }
+
+        size_new_child = (children_sum + num_children - 1) / num_children;
     } else
     {
         size_new_child = calculate_splittable();
@@ -181,43 +491,33 @@ void split_node_t::add_child(std::unique_ptr<tree_node_t> child, wf::txn::transa
         index = num_children;
     }
 
-    /* Add child to the list */
-    child->parent = {this};
+    /* Add child to the list, the arena takes over ownership */
+    auto raw_child = child.release();
+    arena->adopt(raw_child);
 
     // Set size of the child to make sure it gets properly recalculated later
-    child->geometry = get_child_geometry(0, size_new_child);
+    raw_child->geometry = get_child_geometry(0, size_new_child);
 
-    this->children.emplace(this->children.begin() + index, std::move(child));
+    auto before = get_child(index);
+    arena->link(slot, raw_child->slot, before ? before->slot : tree_arena_t::NIL);
     this->focused_idx = index;
 
-    set_gaps(this->gaps, tx);
-
-    /* Recalculate geometry */
-    recalculate_children(geometry, tx);
+    /* The geometry of the child is recalculated in the next layout pass, even
+     * if it ends up unchanged, the view still needs to be configured. */
+    raw_child->mark_dirty();
+    mark_dirty();
 }
 
 std::unique_ptr<tree_node_t> split_node_t::remove_child(
-    nonstd::observer_ptr<tree_node_t> child, wf::txn::transaction_uptr& tx)
+    nonstd::observer_ptr<tree_node_t> child)
 {
-    /* Remove child */
-    std::unique_ptr<tree_node_t> result;
-    auto it = this->children.begin();
-
-    while (it != this->children.end())
-    {
-        if (it->get() == child.get())
-        {
-            result = std::move(*it);
-            it     = this->children.erase(it);
-        } else
-        {
-            ++it;
-        }
-    }
+    /* Remove child, it keeps its slot until it is added somewhere else */
+    assert(child->get_parent().get() == this);
+    arena->unlink(child->slot);
+    std::unique_ptr<tree_node_t> result{child.get()};
 
     /* Remaining children have the full geometry */
-    recalculate_children(this->geometry, tx);
-    result->parent = nullptr;
+    mark_dirty();
 
     return result;
 }
@@ -225,62 +525,74 @@ std::unique_ptr<tree_node_t> split_node_t::remove_child(
 // TODO: looks like ours, might need more updating
 std::unique_ptr<tree_node_t> split_node_t::replace_child(
     nonstd::observer_ptr<tree_node_t> child,
-    std::unique_ptr<tree_node_t> new_child,  wf::txn::transaction_uptr& tx)
-{
-    int idx = child->get_sibling_index();
-    std::unique_ptr<tree_node_t> result = std::move(this->children[idx]);
-    child->parent = nullptr;
-    new_child->set_geometry(child->geometry, tx);
-    new_child->parent = {this};
-    this->children[idx] = std::move(new_child);
-    set_gaps(this->gaps, tx);
+    std::unique_ptr<tree_node_t> new_child)
+{
+    assert(child->get_parent().get() == this);
+    auto raw_child = new_child.release();
+    arena->adopt(raw_child);
+    raw_child->set_geometry(child->geometry);
+
+    arena->link(slot, raw_child->slot, child->slot);
+    arena->unlink(child->slot);
+    std::unique_ptr<tree_node_t> result{child.get()};
+
+    raw_child->mark_dirty();
+    mark_dirty();
     return result;
 }
 
-void split_node_t::set_geometry(wf::geometry_t geometry, wf::txn::transaction_uptr& tx)
+void split_node_t::set_geometry(wf::geometry_t geometry)
 {
-    tree_node_t::set_geometry(geometry, tx);
-    recalculate_children(geometry, tx);
+    tree_node_t::set_geometry(geometry);
 }
 
-void split_node_t::set_gaps(const gap_size_t& gaps, wf::txn::transaction_uptr& tx)
+void split_node_t::set_gaps(const gap_size_t& gaps)
 {
-    this->gaps = gaps;
-    for (const auto& child : this->children)
+    if ((this->gaps.top != gaps.top) ||
+        (this->gaps.bottom != gaps.bottom) ||
+        (this->gaps.left != gaps.left) ||
+        (this->gaps.right != gaps.right) ||
+        (this->gaps.internal != gaps.internal))
     {
-        gap_size_t child_gaps = gaps;
+        this->gaps = gaps;
+        mark_dirty();
+    }
+}
 
-        /* See which edges are modified by this split */
-        int32_t *first_edge, *second_edge;
-        switch (this->split_direction)
-        {
-          case SPLIT_HORIZONTAL:
-            first_edge  = &child_gaps.top;
-            second_edge = &child_gaps.bottom;
-            break;
+gap_size_t split_node_t::calculate_child_gaps(bool first, bool last) const
+{
+    gap_size_t child_gaps = gaps;
 
-          case SPLIT_VERTICAL:
-            first_edge  = &child_gaps.left;
-            second_edge = &child_gaps.right;
-            break;
+    /* See which edges are modified by this split */
+    int32_t *first_edge, *second_edge;
+    switch (this->split_direction)
+    {
+      case SPLIT_HORIZONTAL:
+        first_edge  = &child_gaps.top;
+        second_edge = &child_gaps.bottom;
+        break;
 
-          default:
-            assert(false);
-        }
+      case SPLIT_VERTICAL:
+        first_edge  = &child_gaps.left;
+        second_edge = &child_gaps.right;
+        break;
 
-        /* Override internal edges */
-        if (child != this->children.front())
-        {
-            *first_edge = gaps.internal;
-        }
+      default:
+        assert(false);
+    }
 
-        if (child != this->children.back())
-        {
-            *second_edge = gaps.internal;
-        }
+    /* Override internal edges */
+    if (!first)
+    {
+        *first_edge = gaps.internal;
+    }
 
-        child->set_gaps(child_gaps, tx);
+    if (!last)
+    {
+        *second_edge = gaps.internal;
     }
+
+    return child_gaps;
 }
 
 split_direction_t split_node_t::get_split_direction() const
@@ -288,12 +600,28 @@ split_direction_t split_node_t::get_split_direction() const
     return this->split_direction;
 }
 
-void split_node_t::set_split_direction(split_direction_t direction, wf::txn::transaction_uptr& tx)
+/** The contribution of a split in the given state to the shape hash */
+static uint64_t hash_split_shape(const split_node_t *split,
+    split_direction_t direction, bool tabbed)
+{
+    uint64_t hash = (uint64_t)(uintptr_t)split * 0x9e3779b97f4a7c15ull;
+    hash ^= ((uint64_t)direction << 1 | tabbed) + 0x632be59bd9b4e019ull;
+    return hash * 0xbf58476d1ce4e5b9ull;
+}
+
+void split_node_t::set_split_direction(split_direction_t direction)
 {
     if (this->split_direction != direction)
     {
+        if (arena)
+        {
+            arena->shape_hash ^= hash_split_shape(this, split_direction, tabbed) ^
+                hash_split_shape(this, direction, tabbed);
+            arena->topology_changed();
+        }
+
         this->split_direction = direction;
-        recalculate_children(this->geometry, tx);
+        mark_dirty();
         // TODO: keep relative child propertions.
     }
 }
@@ -303,206 +631,96 @@ bool split_node_t::is_tabbed() const
     return this->tabbed;
 }
 
-void split_node_t::set_tabbed(bool tabbed, wf::txn::transaction_uptr& tx)
+void split_node_t::set_tabbed(bool tabbed)
 {
     if (this->tabbed != tabbed)
     {
-        this->tabbed = tabbed;
-        recalculate_children(this->geometry, tx);
-    }
-}
-
-static void bring_to_front(wf::output_t* output, nonstd::observer_ptr<tree_node_t> node)
-{
-    if (auto split = node->as_split_node())
-    {
-        for (const auto& child : split->children)
+        if (arena)
         {
-            bring_to_front(output, child);
+            arena->shape_hash ^= hash_split_shape(this, split_direction, this->tabbed) ^
+                hash_split_shape(this, split_direction, tabbed);
+            arena->topology_changed();
         }
-    }
-    else if (auto view = node->as_view_node())
-    {
-        wf::view_bring_to_front(view->view);
+
+        this->tabbed = tabbed;
+        mark_dirty();
     }
 }
 
-// TODO: figure out how focus stuff works
-void split_node_t::focus(wf::output_t* output, int idx)
+nonstd::observer_ptr<tree_node_t> split_node_t::get_child(int idx) const
 {
-    // Update the focused node.
-    if (idx != -1)
+    if (!arena)
     {
-        this->focused_idx = idx;
+        return nullptr;
     }
 
-    if (this->focused_idx >= (int)this->children.size())
+    auto& slots = arena->slots;
+    int32_t num_children = slots[slot].num_children;
+    if ((idx < 0) || (idx >= num_children))
     {
-        this->focused_idx = (int)this->children.size();
+        return nullptr;
     }
 
-    /* Bring the view to the front. */
-    nonstd::observer_ptr<tree_node_t> child = this->children[this->focused_idx];
-    bring_to_front(output, child);
-
-    if (auto split_child = child->as_split_node())
+    /* Walk from whichever end is closer */
+    int32_t child;
+    if (idx < num_children / 2)
     {
-        split_child->focus(output);
-    }
-    else if (auto view_child = child->as_view_node())
+        child = slots[slot].first_child;
+        while (slots[child].sibling_index != idx)
+        {
+            child = slots[child].next_sibling;
+        }
+    } else
     {
-        // TODO: figure out how to get fullscreen status of the last focused view
-        // bool was_fullscreen = output->get_active_view()->fullscreen;
-
-        /* This will lower the fullscreen status of the view */
-        output->focus_view(view_child->view, true);
-
-        // if (was_fullscreen)//TODO && keep_fullscreen_on_adjacent)
-        // {
-        //     view_child->view->fullscreen_request(output, true);
-        // }
+        child = slots[slot].last_child;
+        while (slots[child].sibling_index != idx)
+        {
+            child = slots[child].prev_sibling;
+        }
     }
+
+    return nonstd::make_observer(slots[child].node);
 }
 
-split_node_t::split_node_t(split_direction_t dir)
+split_node_t::split_node_t(split_direction_t dir) : tree_node_t(NODE_SPLIT)
 {
+    /* The arena is created once the split gets children, splits which are
+     * added to a tree before that simply take a slot in its arena */
     this->split_direction = dir;
     this->tabbed = false;
     this->focused_idx = 0;
     this->geometry = {0, 0, 0, 0};
 }
 
-/* -------------------- view_node_t implementation -------------------------- */
-struct view_node_custom_data_t : public custom_data_t
+void split_node_t::ensure_arena()
 {
-    nonstd::observer_ptr<view_node_t> ptr;
-    view_node_custom_data_t(view_node_t *node)
-    {
-        ptr = nonstd::make_observer(node);
-    }
-};
-
-/**
- * A simple transformer to scale and translate the view in such a way that
- * its displayed wm geometry region is a specified box on the screen
- */
-static const std::string scale_transformer_name =
-    "better-tiling-scale-transformer";
-struct view_node_t::scale_transformer_t : public wf::scene::view_2d_transformer_t
-{
-    wf::geometry_t box;
-
-    scale_transformer_t(wayfire_toplevel_view view, wf::geometry_t box) :
-        wf::scene::view_2d_transformer_t(view)
+    if (!arena)
     {
-        set_box(box);
-    }
-
-    void set_box(wf::geometry_t box)
-    {
-        assert(box.width > 0 && box.height > 0);
-
-        this->view->damage();
-
-        auto current = toplevel_cast(this->view)->get_geometry();
-        if ((current.width <= 0) || (current.height <= 0))
-        {
-            /* view possibly unmapped?? */
-            return;
-        }
-
-        double scale_horiz = 1.0 * box.width / current.width;
-        double scale_vert  = 1.0 * box.height / current.height;
-
-        /* Position of top-left corner after scaling */
-        double scaled_x = current.x + (current.width / 2.0 * (1 - scale_horiz));
-        double scaled_y = current.y + (current.height / 2.0 * (1 - scale_vert));
-
-        this->scale_x = scale_horiz;
-        this->scale_y = scale_vert;
-        this->translation_x = box.x - scaled_x;
-        this->translation_y = box.y - scaled_y;
+        this->arena = std::make_shared<tree_arena_t>();
+        this->slot  = arena->allocate(this, NODE_SPLIT);
     }
-};
+}
 
-/**
- * A class for animating the view, emits a signal when the animation is over.
- */
-class tile_view_animation_t : public wf::grid::grid_animation_t
+split_node_t::~split_node_t()
 {
-  public:
-    using wf::grid::grid_animation_t::grid_animation_t;
-
-    ~tile_view_animation_t()
+    /* Children unlink themselves from the arena when destroyed */
+    while (!get_children().empty())
     {
-        // The grid animation does this too, however, we want to remove the
-        // transformer so that we can enforce the correct geometry from the
-        // start.
-        view->get_transformed_node()->rem_transformer<grid::crossfade_node_t>();
-
-        tile_adjust_transformer_signal ev;
-        view->emit(&ev);
-
-        // TODO: is this old or custom?
-        // view->pop_transformer("grid-crossfade");
-        // view->emit_signal("better-tiling-adjust-transformer", nullptr);
+        delete get_children().front().get();
     }
+}
 
-    tile_view_animation_t(const tile_view_animation_t &) = delete;
-    tile_view_animation_t(tile_view_animation_t &&) = delete;
-    tile_view_animation_t& operator =(const tile_view_animation_t&) = delete;
-    tile_view_animation_t& operator =(tile_view_animation_t&&) = delete;
-};
-
-view_node_t::view_node_t(wayfire_toplevel_view view)
+/* -------------------- view_node_t implementation -------------------------- */
+view_node_t::view_node_t(std::unique_ptr<tiled_view_t> view) : tree_node_t(NODE_VIEW)
 {
-    this->view = view;
-    view->store_data(std::make_unique<view_node_custom_data_t>(this));
-
-    this->on_geometry_changed.set_callback([=] (auto)
-    {
-        update_transformer();
-    });
-    on_adjust_transformer.set_callback([=] (auto)
-    {
-        update_transformer();
-    });
-
-    view->connect(&on_geometry_changed);
-    view->connect(&on_adjust_transformer);
+    this->view = std::move(view);
+    this->view->node = nonstd::make_observer(this);
 }
 
-// TODO: Ditto as previous
-// {
-//     this->view = view;
-//     view->store_data(std::make_unique<view_node_custom_data_t>(this));
-
-//     this->on_geometry_changed.set_callback([=] (wf::signal_data_t*)
-//     {
-//         update_transformer();
-//     });
-//     this->on_decoration_changed.set_callback([=] (wf::signal_data_t*)
-//     {
-//         set_geometry(geometry);
-//     });
-//     view->connect_signal("geometry-changed", &on_geometry_changed);
-//     view->connect_signal("decoration-changed", &on_decoration_changed);
-//     view->connect_signal("better-tiling-adjust-transformer", &on_geometry_changed);
-// }
-
-// view_node_t::~view_node_t()
-// {
-//     view->pop_transformer(scale_transformer_name);
-//     view->erase_data<view_node_custom_data_t>();
-// }
-
 view_node_t::~view_node_t()
-{
-    view->get_transformed_node()->rem_transformer(scale_transformer_name);
-    view->erase_data<view_node_custom_data_t>();
-}
+{}
 
-void view_node_t::set_gaps(const gap_size_t& size, wf::txn::transaction_uptr& tx)
+void view_node_t::set_gaps(const gap_size_t& size)
 {
     if ((this->gaps.top != size.top) ||
         (this->gaps.bottom != size.bottom) ||
@@ -510,228 +728,245 @@ void view_node_t::set_gaps(const gap_size_t& size, wf::txn::transaction_uptr& tx
         (this->gaps.right != size.right))
     {
         this->gaps = size;
+        mark_dirty();
     }
 }
 
-wf::geometry_t view_node_t::calculate_target_geometry()
+void view_node_t::set_geometry(wf::geometry_t geometry)
 {
-    /* Calculate view geometry in coordinates local to the active workspace,
-     * because tree coordinates are kept in workspace-agnostic coordinates. */
-    auto wset = view->get_wset();
-    auto local_geometry = get_wset_local_coordinates(wset, geometry);
+    tree_node_t::set_geometry(geometry);
+}
 
-    local_geometry.x     += gaps.left;
-    local_geometry.y     += gaps.top;
-    local_geometry.width -= gaps.left + gaps.right;
-    local_geometry.height -= gaps.top + gaps.bottom;
+wf::geometry_t view_node_t::calculate_target_geometry()
+{
+    return view->calculate_target_geometry(geometry, gaps);
+}
 
-    auto size = wset->get_last_output_geometry().value_or(default_output_resolution);
-    /* If view is maximized, we want to use the full available geometry */
-    if (view->pending_fullscreen())
+void view_node_t::apply_geometry(layout_transaction_t& tx)
+{
+    if (!view->is_mapped())
     {
-        auto vp = wset->get_current_workspace();
-        int view_vp_x = std::floor(1.0 * geometry.x / size.width);
-        int view_vp_y = std::floor(1.0 * geometry.y / size.height);
-
-        local_geometry = {
-            (view_vp_x - vp.x) * size.width,
-            (view_vp_y - vp.y) * size.height,
-            size.width,
-            size.height,
-        };
+        return;
     }
 
-    if (view->sticky)
+    auto target = calculate_target_geometry();
+    if ((target == last_target) && view->has_pending_geometry(target))
     {
-        local_geometry.x = (local_geometry.x % size.width + size.width) % size.width;
-        local_geometry.y = (local_geometry.y % size.height + size.height) % size.height;
+        /* Nothing to do, and adding the view to the transaction would only
+         * make it wait for another client commit. */
+        get_stats().record_view(false);
+        return;
     }
 
-    return local_geometry;
+    get_stats().record_view(true);
+    last_target = target;
+
+    view->configure(target, tx);
+    tx.num_views++;
 }
 
-bool view_node_t::needs_crossfade()
+void view_node_t::preview_geometry()
 {
-    if (animation_duration == 0)
+    if (view->is_mapped())
     {
-        return false;
+        view->preview(calculate_target_geometry());
     }
+}
 
-    if (view->has_data<wf::grid::grid_animation_t>())
+/* ----------------- Generic tree operations implementation ----------------- */
+static void flatten_node(nonstd::observer_ptr<tree_node_t> node)
+{
+    /* Cannot flatten a view node */
+    if (node->as_view_node())
     {
-        return true;
+        return;
     }
 
-    if (view->get_output()->is_plugin_active("better-tiling"))
+    auto children = node->get_children();
+
+    /* No flattening required on this level */
+    if (children.size() >= 1)
     {
-        // Disable animations while controllers are active
-        return false;
+        for (auto it = children.begin(); it != children.end();)
+        {
+            /* Flattening may replace the child, so advance first */
+            auto child = *it;
+            ++it;
+            flatten_node(child);
+        }
+
+        return;
     }
 
-    return true;
-}
+    /* Only the real root of the tree can have no children */
+    assert(!node->get_parent() || children.size());
 
-static nonstd::observer_ptr<wf::grid::grid_animation_t> ensure_animation(
-    wayfire_toplevel_view view, wf::option_sptr_t<int> duration)
-{
-    if (!view->has_data<wf::grid::grid_animation_t>())
+    if (children.empty())
     {
-        const auto type = wf::grid::grid_animation_t::CROSSFADE;
-        view->store_data<wf::grid::grid_animation_t>(
-            std::make_unique<tile_view_animation_t>(view, type, duration));
+        return;
     }
 
-    return view->get_data<wf::grid::grid_animation_t>();
-}
-
-void view_node_t::set_geometry(wf::geometry_t geometry, wf::txn::transaction_uptr& tx)
-{
-    tree_node_t::set_geometry(geometry, tx);
+    nonstd::observer_ptr<tree_node_t> child_ptr = children.front();
 
-    if (!view->is_mapped())
+    /* A single view child => cannot make it root */
+    if (child_ptr->as_view_node() || !node->get_parent())
     {
         return;
     }
 
-    wf::get_core().default_wm->update_last_windowed_geometry(view);
-    view->toplevel()->pending().tiled_edges = TILED_EDGES_ALL;
-    tx->add_object(view->toplevel());
+    /* Rewire the tree, skipping the current node */
+    auto child  = node->as_split_node()->remove_child(child_ptr);
+    auto parent = node->get_parent();
+    parent->replace_child(node, std::move(child));
+}
 
-    auto target = calculate_target_geometry();
-    if (this->needs_crossfade() && (target != view->get_geometry()))
-    {
-        view->get_transformed_node()->rem_transformer(scale_transformer_name);
-        ensure_animation(view, animation_duration)
-        ->adjust_target_geometry(target, -1, tx);
-    } else
-    {
-        view->toplevel()->pending().geometry = target;
-        tx->add_object(view->toplevel());
-    }
+void flatten_tree(std::unique_ptr<tree_node_t>& root)
+{
+    flatten_node(root);
 }
 
-// TODO: same
-// void view_node_t::set_geometry(wf::geometry_t geometry)
-// {
-//     tree_node_t::set_geometry(geometry);
+/**
+ * Lay out the dirty part of the subtree. Without a transaction, the views are
+ * only previewed and the flags are kept.
+ */
+static void layout_node(tree_node_t *node, layout_transaction_t *tx)
+{
+    auto& arena = *node->arena;
+    uint8_t flags = arena.slots[node->slot].flags;
 
-//     if (!view->is_mapped())
-//     {
-//         return;
-//     }
+    if (node->kind == NODE_VIEW)
+    {
+        if (!tx)
+        {
+            if (flags & tree_arena_t::LAYOUT_DIRTY)
+            {
+                static_cast<view_node_t*>(node)->preview_geometry();
+            }
 
-//     view->set_tiled(TILED_EDGES_ALL);
+            return;
+        }
 
-//     auto target = calculate_target_geometry();
-//     if (this->needs_crossfade() && (target != view->get_wm_geometry()))
-//     {
-//         if (view->get_transformer(scale_transformer_name))
-//         {
-//             view->pop_transformer(scale_transformer_name);
-//         }
-//         ensure_animation(view, animation_duration)
-//             ->adjust_target_geometry(target, -1);
-//         if (view->get_transformer(scale_transformer_name))
-//         {
-//             view->pop_transformer(scale_transformer_name);
-//         }
-//     }
-//     else
-//     {
-//         view->set_geometry(target);
-//     }
-// }
+        arena.slots[node->slot].flags = 0;
+        if (flags & tree_arena_t::LAYOUT_DIRTY)
+        {
+            static_cast<view_node_t*>(node)->apply_geometry(*tx);
+        }
 
-void view_node_t::update_transformer()
-{
-    auto target_geometry = calculate_target_geometry();
-    if ((target_geometry.width <= 0) || (target_geometry.height <= 0))
-    {
         return;
     }
 
-    if (view->has_data<wf::grid::grid_animation_t>())
+    if (flags & tree_arena_t::LAYOUT_DIRTY)
     {
-        // Still animating
-        return;
+        /* Children marked dirty by the recalculation stop propagating at this
+         * node, since it is still marked as having dirty descendants. */
+        arena.slots[node->slot].flags |= tree_arena_t::LAYOUT_CHILD_DIRTY;
+
+        auto split = static_cast<split_node_t*>(node);
+        split->recalculate_children(split->geometry);
     }
 
-    auto wm = view->get_geometry();
-    if (wm != target_geometry)
+    for (int32_t child = arena.slots[node->slot].first_child;
+         child != tree_arena_t::NIL; child = arena.slots[child].next_sibling)
     {
-        auto tr = ensure_named_transformer<scale_transformer_t>(view,
-            wf::TRANSFORMER_2D, scale_transformer_name, view, target_geometry);
-        tr->set_box(target_geometry);
-    } else
-    {
-        view->get_transformed_node()->rem_transformer(scale_transformer_name);
+        if (arena.slots[child].flags)
+        {
+            layout_node(arena.slots[child].node, tx);
+        }
     }
-}
 
-nonstd::observer_ptr<view_node_t> view_node_t::get_node(wayfire_view view)
-{
-    if (!view->has_data<view_node_custom_data_t>())
+    if (tx)
     {
-        return nullptr;
+        arena.slots[node->slot].flags = 0;
     }
-
-    return view->get_data<view_node_custom_data_t>()->ptr;
 }
 
-/* ----------------- Generic tree operations implementation ----------------- */
-void flatten_tree(std::unique_ptr<tree_node_t>& root, txn::transaction_uptr& tx)
+void layout_tree(nonstd::observer_ptr<tree_node_t> root,
+    layout_transaction_t& tx)
 {
-    /* Cannot flatten a view node */
-    if (root->as_view_node())
+    auto arena = root->arena.get();
+    if (!arena || !arena->slots[root->slot].flags)
     {
         return;
     }
 
-    /* No flattening required on this level */
-    if (root->children.size() >= 1)
+    /* Whole trees return to earlier layouts from the cache */
+    if (arena->slots[root->slot].parent == tree_arena_t::NIL)
     {
-        for (auto& child : root->children)
-        {
-            flatten_tree(child, tx);
-        }
-
-        return;
+        arena->layout_cache.restore(root.get());
     }
 
-    /* Only the real root of the tree can have no children */
-    assert(!root->parent || root->children.size());
+    arena->in_layout = true;
+    layout_node(root.get(), &tx);
+    arena->in_layout = false;
+}
 
-    if (root->children.empty())
+void preview_layout(nonstd::observer_ptr<tree_node_t> root)
+{
+    auto arena = root->arena.get();
+    if (!arena || !arena->slots[root->slot].flags)
     {
         return;
     }
 
-    nonstd::observer_ptr<tree_node_t> child_ptr = {root->children.front()};
-
-    /* A single view child => cannot make it root */
-    if (child_ptr->as_view_node())
+    /* Keep the cache in sync, the previewed geometries are not edits */
+    if (arena->slots[root->slot].parent == tree_arena_t::NIL)
     {
-        if (!root->parent)
-        {
-            return;
-        }
+        arena->layout_cache.restore(root.get());
     }
 
-    /* Rewire the tree, skipping the current root */
-    auto child = root->as_split_node()->remove_child(child_ptr, tx);
-    child->parent = root->parent;
-    root = std::move(child); // overwrite root with the child
+    arena->in_layout = true;
+    layout_node(root.get(), nullptr);
+    arena->in_layout = false;
 }
 
 nonstd::observer_ptr<split_node_t> get_root(
     nonstd::observer_ptr<tree_node_t> node)
 {
-    if (!node->parent)
+    for (auto ancestor : node->get_path())
     {
-        return {dynamic_cast<split_node_t*>(node.get())};
+        node = ancestor;
     }
 
-    return get_root(node->parent);
+    return node->as_split_node();
+}
+
+/**
+ * Remove node from its parent, and then the ancestors which became empty,
+ * stopping at keep and at the root.
+ */
+static std::unique_ptr<tree_node_t> remove_and_collapse(
+    nonstd::observer_ptr<tree_node_t> node,
+    nonstd::observer_ptr<split_node_t> keep,
+    nonstd::observer_ptr<split_node_t>& remaining)
+{
+    remaining = node->get_parent();
+    auto removed = remaining->remove_child(node);
+
+    while (remaining->get_children().empty() && remaining->get_parent() &&
+           (remaining != keep))
+    {
+        auto parent = remaining->get_parent();
+        parent->remove_child(remaining);
+        remaining = parent;
+    }
+
+    return removed;
+}
+
+std::unique_ptr<tree_node_t> remove_node(nonstd::observer_ptr<tree_node_t> node,
+    nonstd::observer_ptr<split_node_t>& remaining)
+{
+    return remove_and_collapse(node, nullptr, remaining);
+}
+
+nonstd::observer_ptr<split_node_t> transplant_node(
+    nonstd::observer_ptr<tree_node_t> node,
+    nonstd::observer_ptr<split_node_t> new_parent, int index)
+{
+    nonstd::observer_ptr<split_node_t> remaining;
+    auto removed = remove_and_collapse(node, new_parent, remaining);
+    new_parent->add_child(std::move(removed), index);
+    return remaining;
 }
 }
 }
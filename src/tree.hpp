@@ -1,11 +1,13 @@
 #ifndef WF_TILE_PLUGIN_TREE
 #define WF_TILE_PLUGIN_TREE
 
-#include <wayfire/view.hpp>
-#include <wayfire/option-wrapper.hpp>
-#include <wayfire/signal-definitions.hpp>
-#include <wayfire/workspace-set.hpp>
-#include <wayfire/txn/transaction.hpp>
+#include <memory>
+#include <vector>
+
+#include "tiled-view.hpp"
+#include "leaf-index.hpp"
+#include "adjacency.hpp"
+#include "layout-cache.hpp"
 
 namespace wf
 {
@@ -22,46 +24,289 @@ namespace tile
 struct split_node_t;
 struct view_node_t;
 
-struct gap_size_t
+/** The kind of a tree node, used instead of RTTI to tell nodes apart */
+enum node_kind_t : uint8_t
 {
-    /* Gap on the left side */
-    int32_t left = 0;
-    /* Gap on the right side */
-    int32_t right = 0;
-    /* Gap on the top side */
-    int32_t top = 0;
-    /* Gap on the bottom side */
-    int32_t bottom = 0;
-    /* Gap for internal splits */
-    int32_t internal = 0;
+    NODE_SPLIT = 0,
+    NODE_VIEW  = 1,
+};
+
+struct tree_node_t;
+
+/**
+ * The topology of a tiling tree, stored in contiguous slots.
+ *
+ * Every node of a tree lives in a slot which is addressed by its index, and
+ * which links to its parent, children and siblings by index as well. This way
+ * walking the tree touches one flat array instead of chasing pointers across
+ * the heap. Each workspace root owns one arena, nodes which are moved between
+ * trees are re-homed into the arena of their new tree.
+ */
+struct tree_arena_t : public std::enable_shared_from_this<tree_arena_t>
+{
+    /** Index of a non-existent slot */
+    static constexpr int32_t NIL = -1;
+
+    /** Layout flags of a slot */
+    enum layout_flags_t : uint8_t
+    {
+        /** The node itself needs to be laid out again */
+        LAYOUT_DIRTY = (1 << 0),
+        /** Some descendant of the node needs to be laid out again */
+        LAYOUT_CHILD_DIRTY = (1 << 1),
+    };
+
+    struct slot_t
+    {
+        tree_node_t *node = nullptr;
+        node_kind_t kind  = NODE_SPLIT;
+
+        int32_t parent = NIL;
+        int32_t first_child  = NIL;
+        int32_t last_child   = NIL;
+        int32_t next_sibling = NIL;
+        int32_t prev_sibling = NIL;
+        int32_t num_children = 0;
+        /** Index of the slot among its siblings */
+        int32_t sibling_index = 0;
+        /** Distance to the root of the tree the slot is in */
+        int32_t depth = 0;
+        uint8_t flags = 0;
+    };
+
+    std::vector<slot_t> slots;
+
+    tree_arena_t();
+
+    /**
+     * Unique for each arena, unlike its address which may be reused once the
+     * arena is freed. Never 0.
+     */
+    const uint64_t id;
+
+    /**
+     * Incremented whenever the topology or the geometry of a node in the
+     * arena changes, so that data derived from the tree can tell when it is
+     * out of date.
+     */
+    uint64_t generation = 0;
+    /**
+     * Incremented only when the structure changes, i.e nodes are linked or
+     * unlinked, or a split changes its direction or tabbed state.
+     */
+    uint64_t topology_generation = 0;
+    /** Incremented only when nodes are linked or unlinked */
+    uint64_t link_generation = 0;
+    /**
+     * Hash of the directions and tabbed states of the splits, relative to
+     * their states when they were created. Updated by the splits themselves.
+     */
+    uint64_t shape_hash = 0;
+
+    /**
+     * Incremented when a node other than a root is resized outside of the
+     * layout pass, i.e its geometry no longer follows from its parent.
+     */
+    uint64_t edit_generation = 0;
+    /** Set while the layout pass assigns the geometry of nodes */
+    bool in_layout = false;
+
+    /** Bump both generations after a structural change */
+    void topology_changed()
+    {
+        ++generation;
+        ++topology_generation;
+    }
+
+    /** Hit-testing index of the tree, rebuilt lazily by find_view_at() */
+    leaf_index_t leaf_index;
+    /** Neighbours of the nodes, rebuilt lazily by find_adjacent() */
+    adjacency_graph_t adjacency;
+    /** Recent layouts of the tree, maintained by layout_tree() */
+    layout_cache_t layout_cache;
+
+    /** Allocate a detached slot for the given node */
+    int32_t allocate(tree_node_t *node, node_kind_t kind);
+    /** Free a slot, it must be detached and without children */
+    void release(int32_t idx);
+
+    /**
+     * Link the detached slot child to parent, before the sibling before.
+     * If before is NIL, the child is appended at the end.
+     */
+    void link(int32_t parent, int32_t child, int32_t before = NIL);
+    /** Detach the slot from its parent */
+    void unlink(int32_t child);
+    /** Exchange the positions of two slots in the tree */
+    void swap(int32_t a, int32_t b);
+
+    /**
+     * Move the detached subtree rooted at node into this arena, releasing its
+     * slots in the old arena.
+     */
+    void adopt(tree_node_t *node);
+
+  private:
+    std::vector<int32_t> free_slots;
+
+    /** Assign consecutive sibling indices starting at the slot first */
+    void renumber(int32_t first, int32_t index);
+    /** Set the depth of the slot and its descendants */
+    void set_depth(int32_t idx, int32_t depth);
+};
+
+/**
+ * A range over the children of a node, in order.
+ */
+struct child_range_t
+{
+    struct iterator
+    {
+        const tree_arena_t *arena;
+        int32_t idx;
+
+        nonstd::observer_ptr<tree_node_t> operator *() const
+        {
+            return nonstd::make_observer(arena->slots[idx].node);
+        }
+
+        iterator& operator ++()
+        {
+            idx = arena->slots[idx].next_sibling;
+            return *this;
+        }
+
+        bool operator ==(const iterator& other) const
+        {
+            return idx == other.idx;
+        }
+
+        bool operator !=(const iterator& other) const
+        {
+            return idx != other.idx;
+        }
+    };
+
+    const tree_arena_t *arena;
+    int32_t parent;
+
+    iterator begin() const;
+    iterator end() const;
+    size_t size() const;
+    bool empty() const;
+    nonstd::observer_ptr<tree_node_t> front() const;
+    nonstd::observer_ptr<tree_node_t> back() const;
+};
+
+/**
+ * A range over a node and its ancestors, from the node up to the root.
+ */
+struct path_range_t
+{
+    struct iterator
+    {
+        const tree_arena_t *arena;
+        int32_t idx;
+
+        nonstd::observer_ptr<tree_node_t> operator *() const
+        {
+            return nonstd::make_observer(arena->slots[idx].node);
+        }
+
+        iterator& operator ++()
+        {
+            idx = arena->slots[idx].parent;
+            return *this;
+        }
+
+        bool operator ==(const iterator& other) const
+        {
+            return idx == other.idx;
+        }
+
+        bool operator !=(const iterator& other) const
+        {
+            return idx != other.idx;
+        }
+    };
+
+    const tree_arena_t *arena;
+    int32_t first;
+
+    iterator begin() const
+    {
+        return {arena, first};
+    }
+
+    iterator end() const
+    {
+        return {arena, tree_arena_t::NIL};
+    }
 };
 
 struct tree_node_t
 {
-    /** The node parent, or nullptr if this is the root node */
-    nonstd::observer_ptr<split_node_t> parent;
+    /** The kind of the node, split or view */
+    const node_kind_t kind;
 
-    /** The children of the node */
-    std::vector<std::unique_ptr<tree_node_t>> children;
+    /**
+     * The arena the node lives in and its slot there. A node which was never
+     * added to a tree has no arena, except for a split which got children
+     * while it had no parent, it becomes the root of its own arena.
+     */
+    std::shared_ptr<tree_arena_t> arena;
+    int32_t slot = tree_arena_t::NIL;
 
     /** The geometry occupied by the node */
     wf::geometry_t geometry;
 
-    /** Set the geometry available for the node and its subnodes. */
-    virtual void set_geometry(wf::geometry_t geometry, wf::txn::transaction_uptr& tx);
+    /**
+     * Set the geometry available for the node and its subnodes.
+     *
+     * Like all other tree mutations, this only marks the affected nodes as
+     * dirty, the actual work happens in the next layout_tree().
+     */
+    virtual void set_geometry(wf::geometry_t geometry);
 
     /** Set the gaps for the node and subnodes. */
-    virtual void set_gaps(const gap_size_t& gaps, wf::txn::transaction_uptr& tx) = 0;
+    virtual void set_gaps(const gap_size_t& gaps) = 0;
+
+    /** Get the gaps around the node */
+    const gap_size_t& get_gaps() const
+    {
+        return gaps;
+    }
+
+    /**
+     * Mark the node as in need of layout, and its ancestors as having a
+     * dirty descendant.
+     */
+    void mark_dirty();
 
-    virtual ~tree_node_t()
-    {}
+    tree_node_t(node_kind_t kind);
+    virtual ~tree_node_t();
+
+    tree_node_t(const tree_node_t&) = delete;
+    tree_node_t& operator =(const tree_node_t&) = delete;
+
+    /** The node parent, or nullptr if this is the root node */
+    nonstd::observer_ptr<split_node_t> get_parent() const;
+
+    /** The children of the node */
+    child_range_t get_children() const;
 
     /** Get the index in the parent child list. */
-    int get_sibling_index();
+    int get_sibling_index() const;
+
+    /** The node itself and its ancestors, up to the root */
+    path_range_t get_path() const;
 
-    /** Simply dynamic cast this to a split_node_t */
+    /** The distance to the root of the tree, 0 for the root itself */
+    int get_depth() const;
+
+    /** Cast this to a split_node_t, or nullptr if it is a view node */
     nonstd::observer_ptr<split_node_t> as_split_node();
-    /** Simply dynamic cast this to a view_node_t */
+    /** Cast this to a view_node_t, or nullptr if it is a split node */
     nonstd::observer_ptr<view_node_t> as_view_node();
 
   protected:
@@ -69,6 +314,12 @@ struct tree_node_t
     gap_size_t gaps;
 };
 
+/**
+ * Exchange the positions of two nodes of the same tree.
+ */
+void swap_nodes(nonstd::observer_ptr<tree_node_t> a,
+    nonstd::observer_ptr<tree_node_t> b);
+
 
 /**
  * A node which contains a split can be split either horizontally or vertically
@@ -89,30 +340,28 @@ struct split_node_t : public tree_node_t
      *
      * The new child will get resized so that its area is at most 1/(N+1) of the
      * total node area, where N is the number of children before adding the new
-     * child.
+     * child, once the tree is laid out.
      *
      * @param index The index at which to insert the new child, or -1 for
      *              adding to the end of the child list.
      */
-    void add_child(std::unique_ptr<tree_node_t> child, wf::txn::transaction_uptr& tx, int index = -1);
+    void add_child(std::unique_ptr<tree_node_t> child, int index = -1);
 
     /**
      * Remove a child from the node, and return its unique_ptr
      */
     std::unique_ptr<tree_node_t> remove_child(
-        nonstd::observer_ptr<tree_node_t> child, wf::txn::transaction_uptr& tx);
+        nonstd::observer_ptr<tree_node_t> child);
 
     /**
      * Replaces a child in the node, and return the old childs unique_ptr.
      */
     std::unique_ptr<tree_node_t> replace_child(
         nonstd::observer_ptr<tree_node_t> child,
-        std::unique_ptr<tree_node_t> new_child,  wf::txn::transaction_uptr& tx);
+        std::unique_ptr<tree_node_t> new_child);
 
-    /**
-     * Focus the child node at focused_idx.
-     */
-    void focus(wf::output_t* output, int idx = -1);
+    /** Get the child at the given index, or nullptr if out of range. */
+    nonstd::observer_ptr<tree_node_t> get_child(int idx) const;
     inline int get_focused_idx() const { return focused_idx; };
     inline void set_focused_idx(int idx) { focused_idx = idx; };
 
@@ -121,23 +370,30 @@ struct split_node_t : public tree_node_t
      * resize the children nodes, so that they fit inside the new geometry and
      * have a size proportional to their old size.
      */
-    void set_geometry(wf::geometry_t geometry, wf::txn::transaction_uptr& tx) override;
+    void set_geometry(wf::geometry_t geometry) override;
 
     /**
      * Set the gaps for the subnodes. The internal gap will override
      * the corresponding edges for each child.
      */
-    void set_gaps(const gap_size_t& gaps, wf::txn::transaction_uptr& tx) override;
+    void set_gaps(const gap_size_t& gaps) override;
 
     split_node_t(split_direction_t direction);
+    ~split_node_t();
     split_direction_t get_split_direction() const;
-    void set_split_direction(split_direction_t direction, wf::txn::transaction_uptr& tx);
+    void set_split_direction(split_direction_t direction);
 
     /**
      * TODO
      */
     bool is_tabbed() const;
-    void set_tabbed(bool tabbed, wf::txn::transaction_uptr& tx);
+    void set_tabbed(bool tabbed);
+
+    /**
+     * Resize the children so that they fit inside the given
+     * available_geometry. Only meant to be called from the layout pass.
+     */
+    void recalculate_children(wf::geometry_t available_geometry);
 
   private:
     split_direction_t split_direction;
@@ -145,10 +401,10 @@ struct split_node_t : public tree_node_t
     int focused_idx;
 
     /**
-     * Resize the children so that they fit inside the given
-     * available_geometry.
+     * Calculate the gaps of a child, which are the gaps of the split with the
+     * edges between children overridden by the internal gap.
      */
-    void recalculate_children(wf::geometry_t available_geometry, wf::txn::transaction_uptr& tx);
+    gap_size_t calculate_child_gaps(bool first, bool last) const;
 
     /**
      * Calculate the geometry of a child if it has child_size as one
@@ -166,20 +422,20 @@ struct split_node_t : public tree_node_t
     /** Return the size of the geometry in the dimension in which the split
      * happens */
     int32_t calculate_splittable(wf::geometry_t geometry) const;
-};
 
-struct tile_adjust_transformer_signal
-{};
+    /** Give the split an arena of its own if it is not in a tree yet */
+    void ensure_arena();
+};
 
 /**
  * Represents a leaf in the tree, contains a single view
  */
 struct view_node_t : public tree_node_t
 {
-    view_node_t(wayfire_toplevel_view view);
+    view_node_t(std::unique_ptr<tiled_view_t> view);
     ~view_node_t();
 
-    wayfire_toplevel_view view;
+    std::unique_ptr<tiled_view_t> view;
     /**
      * Set the geometry of the node and the contained view.
      *
@@ -187,35 +443,47 @@ struct view_node_t : public tree_node_t
      * geometry of the node. For example, a fullscreen view will always have
      * the geometry of the whole output.
      */
-    void set_geometry(wf::geometry_t geometry, wf::txn::transaction_uptr& tx) override;
+    void set_geometry(wf::geometry_t geometry) override;
 
     /**
      * Set the gaps for non-fullscreen mode.
      * The gap sizes will be subtracted from all edges of the view's geometry.
      */
-    void set_gaps(const gap_size_t& gaps, wf::txn::transaction_uptr& tx) override;
-
-    /* Return the tree node corresponding to the view, or nullptr if none */
-    static nonstd::observer_ptr<view_node_t> get_node(wayfire_view view);
+    void set_gaps(const gap_size_t& gaps) override;
 
-  private:
-    struct scale_transformer_t;
-    nonstd::observer_ptr<scale_transformer_t> transformer;
-
-    wf::signal::connection_t<view_geometry_changed_signal> on_geometry_changed;
-    wf::signal::connection_t<tile_adjust_transformer_signal> on_adjust_transformer;
+    /** Calculate the geometry of the view for the current node geometry */
+    wf::geometry_t calculate_target_geometry();
 
-    wf::option_wrapper_t<int> animation_duration{"better-tiling/animation_duration"};
+    /**
+     * Send the node geometry to the view as part of the given transaction.
+     * Called by the layout pass for each dirty view node.
+     */
+    void apply_geometry(layout_transaction_t& tx);
 
+    /** Show the node geometry on the view without configuring it */
+    void preview_geometry();
 
     /**
-     * Check whether the crossfade animation should be enabled for the view
-     * currently.
+     * A resizing pair found for the node, valid while the topology of its
+     * tree does not change and the edge of the node is still in the other
+     * node of the pair. Maintained by find_resizing_pair(), which only stores
+     * pairs which were found.
      */
-    bool needs_crossfade();
+    struct resizing_pair_cache_t
+    {
+        /** The id of the arena the pair was found in, 0 if none */
+        uint64_t arena_id = 0;
+        uint64_t topology_generation = 0;
+        nonstd::observer_ptr<tree_node_t> first;
+        nonstd::observer_ptr<tree_node_t> second;
+    };
+
+    /** Cached resizing pairs, indexed by split_insertion_t - 1 */
+    resizing_pair_cache_t resizing_pairs[4];
 
-    wf::geometry_t calculate_target_geometry();
-    void update_transformer();
+  private:
+    /** The geometry last sent to the view by apply_geometry() */
+    wf::geometry_t last_target = {0, 0, 0, 0};
 };
 
 /**
@@ -227,7 +495,25 @@ struct view_node_t : public tree_node_t
  * Note: this will potentially invalidate pointers to the tree and modify
  * the given parameter.
  */
-void flatten_tree(std::unique_ptr<tree_node_t>& root, wf::txn::transaction_uptr& tx);
+void flatten_tree(std::unique_ptr<tree_node_t>& root);
+
+/**
+ * Recompute the geometry of all dirty nodes in the tree, and add each view
+ * whose geometry changed to the transaction exactly once.
+ *
+ * Nodes which are not dirty and have no dirty descendants are not visited.
+ */
+void layout_tree(nonstd::observer_ptr<tree_node_t> root,
+    layout_transaction_t& tx);
+
+/**
+ * Recompute the geometry of all dirty nodes in the tree like layout_tree(),
+ * but only preview the new geometries on the views.
+ *
+ * The nodes are left dirty, so that the next layout_tree() sends the real
+ * geometries to the views.
+ */
+void preview_layout(nonstd::observer_ptr<tree_node_t> root);
 
 /**
  * Get the root of the tree which node is part of
@@ -235,15 +521,27 @@ void flatten_tree(std::unique_ptr<tree_node_t>& root, wf::txn::transaction_uptr&
 nonstd::observer_ptr<split_node_t> get_root(nonstd::observer_ptr<tree_node_t> node);
 
 /**
- * Transform coordinates from the tiling trees coordinate system to wset-local coordinates.
+ * Remove the node from its tree, together with the splits which become empty
+ * because of that. The root of the tree is never removed.
+ *
+ * @param remaining Set to the nearest ancestor of the node which is still in
+ *                  the tree, which is where the tree needs to be laid out.
+ * @return The removed node with its subtree
  */
-wf::geometry_t get_wset_local_coordinates(std::shared_ptr<wf::workspace_set_t> wset, wf::geometry_t g);
-wf::point_t get_wset_local_coordinates(std::shared_ptr<wf::workspace_set_t> wset, wf::point_t g);
+std::unique_ptr<tree_node_t> remove_node(nonstd::observer_ptr<tree_node_t> node,
+    nonstd::observer_ptr<split_node_t>& remaining);
 
-// Since wsets may not have been attached to any output yet, they may not have a native 'resolution'.
-// In this case, we use a default resolution of 1920x1080 in order to layout views. This resolution will be
-// automatically adjusted once the wset is added to an output.
-static constexpr wf::geometry_t default_output_resolution = {0, 0, 1920, 1080};
+/**
+ * Move the node with its whole subtree to new_parent, which may be in another
+ * tree. The subtree keeps the proportions of its children, and splits which
+ * become empty are removed like in remove_node().
+ *
+ * @param index The index in new_parent, or -1 to add the node at the end
+ * @return The nearest remaining ancestor of the old position of the node
+ */
+nonstd::observer_ptr<split_node_t> transplant_node(
+    nonstd::observer_ptr<tree_node_t> node,
+    nonstd::observer_ptr<split_node_t> new_parent, int index = -1);
 }
 }
 
@@ -0,0 +1,306 @@
+#include "wayfire-view.hpp"
+#include "tile-animation.hpp"
+
+#include <cmath>
+
+#include <wayfire/core.hpp>
+#include <wayfire/util.hpp>
+#include <wayfire/output.hpp>
+#include <wayfire/view-transform.hpp>
+#include <wayfire/view-helpers.hpp>
+// #include "crossfade.hpp"
+
+namespace wf
+{
+namespace tile
+{
+wf::point_t get_wset_local_coordinates(std::shared_ptr<wf::workspace_set_t> wset, wf::point_t p)
+{
+    auto vp   = wset->get_current_workspace();
+    auto size = wset->get_last_output_geometry().value_or(default_output_resolution);
+    p.x -= vp.x * size.width;
+    p.y -= vp.y * size.height;
+    return p;
+}
+
+wf::geometry_t get_wset_local_coordinates(std::shared_ptr<wf::workspace_set_t> wset, wf::geometry_t g)
+{
+    auto new_tl = get_wset_local_coordinates(wset, wf::point_t{g.x, g.y});
+    g.x = new_tl.x;
+    g.y = new_tl.y;
+
+    return g;
+}
+
+struct tiled_view_custom_data_t : public custom_data_t
+{
+    nonstd::observer_ptr<wayfire_tiled_view_t> ptr;
+    tiled_view_custom_data_t(wayfire_tiled_view_t *view)
+    {
+        ptr = nonstd::make_observer(view);
+    }
+};
+
+const std::string scale_transformer_name = "better-tiling-scale-transformer";
+
+scale_transformer_t::scale_transformer_t(wayfire_toplevel_view view,
+    wf::geometry_t box) :
+    wf::scene::view_2d_transformer_t(view)
+{
+    set_box(box);
+}
+
+void scale_transformer_t::set_box(wf::geometry_t box)
+{
+    assert(box.width > 0 && box.height > 0);
+
+    this->box = box;
+    this->view->damage();
+
+    auto current = toplevel_cast(this->view)->get_geometry();
+    if ((current.width <= 0) || (current.height <= 0))
+    {
+        /* view possibly unmapped?? */
+        return;
+    }
+
+    double scale_horiz = 1.0 * box.width / current.width;
+    double scale_vert  = 1.0 * box.height / current.height;
+
+    /* Position of top-left corner after scaling */
+    double scaled_x = current.x + (current.width / 2.0 * (1 - scale_horiz));
+    double scaled_y = current.y + (current.height / 2.0 * (1 - scale_vert));
+
+    this->scale_x = scale_horiz;
+    this->scale_y = scale_vert;
+    this->translation_x = box.x - scaled_x;
+    this->translation_y = box.y - scaled_y;
+}
+
+/* ------------------ wayfire_tiled_view_t implementation ------------------- */
+wayfire_tiled_view_t::wayfire_tiled_view_t(wayfire_toplevel_view view)
+{
+    this->view = view;
+    view->store_data(std::make_unique<tiled_view_custom_data_t>(this));
+
+    this->on_geometry_changed.set_callback([=] (auto)
+    {
+        update_transformer();
+    });
+    on_adjust_transformer.set_callback([=] (auto)
+    {
+        update_transformer();
+    });
+
+    view->connect(&on_geometry_changed);
+    view->connect(&on_adjust_transformer);
+}
+
+wayfire_tiled_view_t::~wayfire_tiled_view_t()
+{
+    view->get_transformed_node()->rem_transformer(scale_transformer_name);
+    view->erase_data<tiled_view_custom_data_t>();
+}
+
+bool wayfire_tiled_view_t::is_mapped()
+{
+    return view->is_mapped();
+}
+
+wf::geometry_t wayfire_tiled_view_t::calculate_target_geometry(
+    wf::geometry_t geometry, const gap_size_t& gaps)
+{
+    /* Calculate view geometry in coordinates local to the active workspace,
+     * because tree coordinates are kept in workspace-agnostic coordinates. */
+    auto wset = view->get_wset();
+    auto local_geometry = get_wset_local_coordinates(wset, geometry);
+
+    local_geometry.x     += gaps.left;
+    local_geometry.y     += gaps.top;
+    local_geometry.width -= gaps.left + gaps.right;
+    local_geometry.height -= gaps.top + gaps.bottom;
+
+    auto size = wset->get_last_output_geometry().value_or(default_output_resolution);
+    /* If view is maximized, we want to use the full available geometry */
+    if (view->pending_fullscreen())
+    {
+        auto vp = wset->get_current_workspace();
+        int view_vp_x = std::floor(1.0 * geometry.x / size.width);
+        int view_vp_y = std::floor(1.0 * geometry.y / size.height);
+
+        local_geometry = {
+            (view_vp_x - vp.x) * size.width,
+            (view_vp_y - vp.y) * size.height,
+            size.width,
+            size.height,
+        };
+    }
+
+    if (view->sticky)
+    {
+        local_geometry.x = (local_geometry.x % size.width + size.width) % size.width;
+        local_geometry.y = (local_geometry.y % size.height + size.height) % size.height;
+    }
+
+    return local_geometry;
+}
+
+bool wayfire_tiled_view_t::has_pending_geometry(wf::geometry_t target)
+{
+    auto& pending = view->toplevel()->pending();
+    return (pending.geometry == target) && (pending.tiled_edges == TILED_EDGES_ALL);
+}
+
+bool wayfire_tiled_view_t::needs_animation()
+{
+    auto animations = animation_scheduler_t::get(view->get_output());
+    if ((animation_duration == 0) || !animations)
+    {
+        return false;
+    }
+
+    if (animations->is_animating(view))
+    {
+        return true;
+    }
+
+    if (view->get_output()->is_plugin_active("better-tiling"))
+    {
+        // Disable animations while controllers are active
+        return false;
+    }
+
+    return true;
+}
+
+void wayfire_tiled_view_t::configure(wf::geometry_t target,
+    layout_transaction_t& layout_tx)
+{
+    auto& tx = static_cast<wayfire_transaction_t&>(layout_tx).tx;
+    auto& pending = view->toplevel()->pending();
+
+    wf::get_core().default_wm->update_last_windowed_geometry(view);
+    pending.tiled_edges = TILED_EDGES_ALL;
+
+    /* The scheduler takes over the scale transformer while animating */
+    if (!this->needs_animation() || (target == view->get_geometry()) ||
+        !animation_scheduler_t::get(view->get_output())->animate(view, target))
+    {
+        pending.geometry = target;
+    }
+
+    tx->add_object(view->toplevel());
+}
+
+void wayfire_tiled_view_t::preview(wf::geometry_t target)
+{
+    set_transformer_box(target);
+}
+
+void wayfire_tiled_view_t::update_transformer()
+{
+    set_transformer_box(node->calculate_target_geometry());
+}
+
+void wayfire_tiled_view_t::set_transformer_box(wf::geometry_t target_geometry)
+{
+    if ((target_geometry.width <= 0) || (target_geometry.height <= 0))
+    {
+        return;
+    }
+
+    auto animations = animation_scheduler_t::get(view->get_output());
+    if (animations && animations->is_animating(view))
+    {
+        // Still animating
+        return;
+    }
+
+    auto wm = view->get_geometry();
+    if (wm != target_geometry)
+    {
+        auto tr = ensure_named_transformer<scale_transformer_t>(view,
+            wf::TRANSFORMER_2D, scale_transformer_name, view, target_geometry);
+        tr->set_box(target_geometry);
+    } else
+    {
+        view->get_transformed_node()->rem_transformer(scale_transformer_name);
+    }
+}
+
+/* ----------------------------- Node helpers ------------------------------- */
+std::unique_ptr<view_node_t> create_view_node(wayfire_toplevel_view view)
+{
+    return std::make_unique<view_node_t>(
+        std::make_unique<wayfire_tiled_view_t>(view));
+}
+
+nonstd::observer_ptr<view_node_t> get_view_node(wayfire_view view)
+{
+    if (!view->has_data<tiled_view_custom_data_t>())
+    {
+        return nullptr;
+    }
+
+    return view->get_data<tiled_view_custom_data_t>()->ptr->node;
+}
+
+wayfire_toplevel_view get_wayfire_view(nonstd::observer_ptr<view_node_t> node)
+{
+    return static_cast<wayfire_tiled_view_t*>(node->view.get())->view;
+}
+
+static void bring_to_front(nonstd::observer_ptr<tree_node_t> node)
+{
+    if (auto split = node->as_split_node())
+    {
+        for (auto child : split->get_children())
+        {
+            bring_to_front(child);
+        }
+    }
+    else if (auto view = node->as_view_node())
+    {
+        wf::view_bring_to_front(get_wayfire_view(view));
+    }
+}
+
+// TODO: figure out how focus stuff works
+void focus_child(wf::output_t *output, nonstd::observer_ptr<split_node_t> split,
+    int idx)
+{
+    // Update the focused node.
+    if (idx != -1)
+    {
+        split->set_focused_idx(idx);
+    }
+
+    if (split->get_focused_idx() >= (int)split->get_children().size())
+    {
+        split->set_focused_idx((int)split->get_children().size());
+    }
+
+    /* Bring the view to the front. */
+    nonstd::observer_ptr<tree_node_t> child = split->get_child(split->get_focused_idx());
+    bring_to_front(child);
+
+    if (auto split_child = child->as_split_node())
+    {
+        focus_child(output, split_child);
+    }
+    else if (auto view_child = child->as_view_node())
+    {
+        // TODO: figure out how to get fullscreen status of the last focused view
+        // bool was_fullscreen = output->get_active_view()->fullscreen;
+
+        /* This will lower the fullscreen status of the view */
+        output->focus_view(get_wayfire_view(view_child), true);
+
+        // if (was_fullscreen)//TODO && keep_fullscreen_on_adjacent)
+        // {
+        //     view_child->view->fullscreen_request(output, true);
+        // }
+    }
+}
+}
+}
@@ -0,0 +1,110 @@
+#ifndef WF_TILE_PLUGIN_WAYFIRE_VIEW_HPP
+#define WF_TILE_PLUGIN_WAYFIRE_VIEW_HPP
+
+#include "tree.hpp"
+
+#include <wayfire/view.hpp>
+#include <wayfire/option-wrapper.hpp>
+#include <wayfire/signal-definitions.hpp>
+#include <wayfire/view-transform.hpp>
+#include <wayfire/workspace-set.hpp>
+#include <wayfire/txn/transaction.hpp>
+
+/* Contains the glue between the tiling tree and wayfire views */
+namespace wf
+{
+namespace tile
+{
+struct tile_adjust_transformer_signal
+{};
+
+/**
+ * A layout transaction backed by a wayfire transaction.
+ */
+class wayfire_transaction_t : public layout_transaction_t
+{
+  public:
+    wf::txn::transaction_uptr tx = wf::txn::transaction_t::create();
+};
+
+/** The name under which tiled views keep their scale_transformer_t */
+extern const std::string scale_transformer_name;
+
+/**
+ * A simple transformer to scale and translate the view in such a way that
+ * its displayed wm geometry region is a specified box on the screen. The
+ * slide animation moves the same box, so that a view has one 2D transformer.
+ */
+struct scale_transformer_t : public wf::scene::view_2d_transformer_t
+{
+    wf::geometry_t box;
+
+    scale_transformer_t(wayfire_toplevel_view view, wf::geometry_t box);
+    void set_box(wf::geometry_t box);
+};
+
+/**
+ * A tiled wayfire toplevel. Takes care of configuring the view, animating it
+ * and keeping the scale transformer in sync with the node geometry.
+ */
+class wayfire_tiled_view_t : public tiled_view_t
+{
+  public:
+    wayfire_tiled_view_t(wayfire_toplevel_view view);
+    ~wayfire_tiled_view_t();
+
+    wayfire_toplevel_view view;
+
+    bool is_mapped() override;
+    wf::geometry_t calculate_target_geometry(
+        wf::geometry_t node_geometry, const gap_size_t& gaps) override;
+    bool has_pending_geometry(wf::geometry_t target) override;
+    void configure(wf::geometry_t target, layout_transaction_t& tx) override;
+    void preview(wf::geometry_t target) override;
+
+  private:
+    wf::signal::connection_t<view_geometry_changed_signal> on_geometry_changed;
+    wf::signal::connection_t<tile_adjust_transformer_signal> on_adjust_transformer;
+
+    wf::option_wrapper_t<int> animation_duration{"better-tiling/animation_duration"};
+
+    /**
+     * Check whether the resize animation should be enabled for the view
+     * currently.
+     */
+    bool needs_animation();
+    void update_transformer();
+    /** Make the view appear at target, using the scale transformer if needed */
+    void set_transformer_box(wf::geometry_t target);
+};
+
+/** Create a new view node for the given view */
+std::unique_ptr<view_node_t> create_view_node(wayfire_toplevel_view view);
+
+/* Return the tree node corresponding to the view, or nullptr if none */
+nonstd::observer_ptr<view_node_t> get_view_node(wayfire_view view);
+
+/** Return the wayfire view contained in the node */
+wayfire_toplevel_view get_wayfire_view(nonstd::observer_ptr<view_node_t> node);
+
+/**
+ * Focus the child of the split node at idx, or the last focused child if idx
+ * is -1.
+ */
+void focus_child(wf::output_t *output, nonstd::observer_ptr<split_node_t> split,
+    int idx = -1);
+
+/**
+ * Transform coordinates from the tiling trees coordinate system to wset-local coordinates.
+ */
+wf::geometry_t get_wset_local_coordinates(std::shared_ptr<wf::workspace_set_t> wset, wf::geometry_t g);
+wf::point_t get_wset_local_coordinates(std::shared_ptr<wf::workspace_set_t> wset, wf::point_t g);
+
+// Since wsets may not have been attached to any output yet, they may not have a native 'resolution'.
+// In this case, we use a default resolution of 1920x1080 in order to layout views. This resolution will be
+// automatically adjusted once the wset is added to an output.
+static constexpr wf::geometry_t default_output_resolution = {0, 0, 1920, 1080};
+}
+}
+
+#endif /* end of include guard: WF_TILE_PLUGIN_WAYFIRE_VIEW_HPP */
@@ -0,0 +1,124 @@
+#include "tree-search.hpp"
+#include "check.hpp"
+#include "random-tree.hpp"
+
+/*
+ * Checks that the adjacency graph finds the same neighbours and split
+ * ancestors as climbing the tree, which it replaced. The graph is queried
+ * after every change of a growing tree, so that stale links are caught.
+ */
+using namespace wf::tile;
+
+/** find_adjacent() before the adjacency graph */
+static split_position_t climb_adjacent(nonstd::observer_ptr<tree_node_t> node,
+    split_direction_t axis, int step)
+{
+    while (node->get_parent())
+    {
+        auto parent = node->get_parent();
+        int idx     = node->get_sibling_index() + step;
+        if ((parent->get_split_direction() == axis) && (idx >= 0) &&
+            (idx < (int)parent->get_children().size()))
+        {
+            return {parent, idx};
+        }
+
+        node = parent;
+    }
+
+    return {};
+}
+
+/** find_split_ancestor() before the adjacency graph */
+static split_position_t climb_split_ancestor(
+    nonstd::observer_ptr<tree_node_t> node, split_direction_t axis)
+{
+    while (node->get_parent())
+    {
+        if (node->get_parent()->get_split_direction() == axis)
+        {
+            return {node->get_parent(), node->get_sibling_index()};
+        }
+
+        node = node->get_parent();
+    }
+
+    return {};
+}
+
+static bool operator ==(const split_position_t& a, const split_position_t& b)
+{
+    return (a.split == b.split) && (!a.split || (a.index == b.index));
+}
+
+/** Collect all nodes of the tree, in depth-first order */
+static void collect_nodes(nonstd::observer_ptr<tree_node_t> node,
+    std::vector<nonstd::observer_ptr<tree_node_t>>& nodes)
+{
+    nodes.push_back(node);
+    for (auto child : node->get_children())
+    {
+        collect_nodes(child, nodes);
+    }
+}
+
+int main()
+{
+    const split_insertion_t directions[] = {
+        INSERT_LEFT, INSERT_RIGHT, INSERT_ABOVE, INSERT_BELOW
+    };
+
+    std::mt19937 rng(2);
+    for (int tree = 0; tree < 300; tree++)
+    {
+        std::unique_ptr<tree_node_t> root =
+            std::make_unique<split_node_t>(SPLIT_VERTICAL);
+        std::vector<nonstd::observer_ptr<split_node_t>> splits = {
+            root->as_split_node()
+        };
+
+        int num_views = 1 + rng() % 100;
+        for (int i = 0; i < num_views; i++)
+        {
+            auto parent = splits[rng() % splits.size()];
+            if (rng() % 3 == 0)
+            {
+                auto split = std::make_unique<split_node_t>(
+                    (rng() % 2) ? SPLIT_VERTICAL : SPLIT_HORIZONTAL);
+                split->add_child(headless::create_view_node());
+                splits.push_back(nonstd::make_observer(split.get()));
+                parent->add_child(std::move(split));
+            } else
+            {
+                int idx = rng() % (parent->get_children().size() + 1);
+                parent->add_child(headless::create_view_node(), idx);
+            }
+
+            if (rng() % 5 == 0)
+            {
+                splits[rng() % splits.size()]->set_split_direction(
+                    (rng() % 2) ? SPLIT_VERTICAL : SPLIT_HORIZONTAL);
+            }
+
+            std::vector<nonstd::observer_ptr<tree_node_t>> nodes;
+            collect_nodes(root, nodes);
+            auto node = nodes[rng() % nodes.size()];
+            for (auto direction : directions)
+            {
+                bool horizontal =
+                    (direction == INSERT_LEFT) || (direction == INSERT_RIGHT);
+                auto axis = horizontal ? SPLIT_VERTICAL : SPLIT_HORIZONTAL;
+                int step  =
+                    ((direction == INSERT_LEFT) || (direction == INSERT_ABOVE)) ?
+                    -1 : 1;
+
+                CHECK_MSG(find_adjacent(node, direction) ==
+                    climb_adjacent(node, axis, step), "tree %d", tree);
+                CHECK_MSG(find_split_ancestor(node, direction) ==
+                    climb_split_ancestor(node, axis), "tree %d", tree);
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
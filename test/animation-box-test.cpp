@@ -0,0 +1,44 @@
+#include <cmath>
+
+#include "animation-box.hpp"
+#include "check.hpp"
+
+/*
+ * Checks the box in which the slide animation shows a view: it starts at the
+ * old geometry, follows the circle smoothing of wayfire animations, and ends
+ * at the new geometry.
+ */
+using namespace wf::tile;
+
+int main()
+{
+    wf::geometry_t start = {0, 0, 100, 100};
+    wf::geometry_t end   = {100, 200, 300, 100};
+
+    CHECK(animation_box(start, end, 0.0) == start);
+    CHECK(animation_box(start, end, 1.0) == end);
+
+    /* The circle smoothing is sqrt(t * (2 - t)), about 0.866 at t = 0.5 */
+    CHECK(std::abs(animation_progress(0.5) - std::sqrt(0.75)) < 1e-9);
+    wf::geometry_t half = {87, 173, 273, 100};
+    CHECK(animation_box(start, end, 0.5) == half);
+
+    /* Shrinking and moving back are interpolated the same way */
+    wf::geometry_t back = {13, 27, 127, 100};
+    CHECK(animation_box(end, start, 0.5) == back);
+
+    /* Times outside of the animation are clamped to its ends */
+    CHECK(animation_box(start, end, -1.0) == start);
+    CHECK(animation_box(start, end, 2.0) == end);
+
+    /* Progress never goes backwards */
+    double last = 0.0;
+    for (int i = 0; i <= 100; i++)
+    {
+        double progress = animation_progress(i / 100.0);
+        CHECK(progress >= last);
+        last = progress;
+    }
+
+    return EXIT_SUCCESS;
+}
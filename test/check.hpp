@@ -0,0 +1,32 @@
+#ifndef WF_TILE_PLUGIN_TEST_CHECK_HPP
+#define WF_TILE_PLUGIN_TEST_CHECK_HPP
+
+#include <cstdio>
+#include <cstdlib>
+
+/**
+ * Fail the test from main() when cond does not hold, reporting where.
+ */
+#define CHECK(cond) \
+    if (!(cond)) \
+    { \
+        std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+            #cond); \
+        return EXIT_FAILURE; \
+    }
+
+/**
+ * Like CHECK(), and also report where in the random input it failed, with a
+ * printf format and its arguments.
+ */
+#define CHECK_MSG(cond, ...) \
+    if (!(cond)) \
+    { \
+        std::fprintf(stderr, "%s:%d: check failed: %s: ", __FILE__, __LINE__, \
+            #cond); \
+        std::fprintf(stderr, __VA_ARGS__); \
+        std::fprintf(stderr, "\n"); \
+        return EXIT_FAILURE; \
+    }
+
+#endif /* end of include guard: WF_TILE_PLUGIN_TEST_CHECK_HPP */
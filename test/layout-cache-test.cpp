@@ -0,0 +1,165 @@
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+
+#include "tile-stats.hpp"
+#include "check.hpp"
+#include "random-tree.hpp"
+
+/*
+ * Checks that returning to an earlier layout restores exactly the geometries
+ * the views had in it, while rescaling alone would accumulate rounding
+ * errors, and that adding, removing or resizing nodes forgets the earlier
+ * layouts.
+ */
+using namespace wf::tile;
+
+/** The current geometries of the views of the tree, in depth-first order */
+static std::vector<wf::geometry_t> view_geometries(
+    nonstd::observer_ptr<tree_node_t> root)
+{
+    std::vector<nonstd::observer_ptr<view_node_t>> views;
+    test::collect_views(root, views);
+
+    std::vector<wf::geometry_t> geometries;
+    for (auto& view : views)
+    {
+        geometries.push_back(headless::get_headless_view(view)->current);
+    }
+
+    return geometries;
+}
+
+static bool operator ==(const std::vector<wf::geometry_t>& a,
+    const std::vector<wf::geometry_t>& b)
+{
+    if (a.size() != b.size())
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        if (a[i] != b[i])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void lay_out(nonstd::observer_ptr<tree_node_t> root)
+{
+    headless::headless_transaction_t tx;
+    layout_tree(root, tx);
+    tx.apply();
+}
+
+int main()
+{
+    const wf::geometry_t full  = {0, 0, 1921, 1079};
+    const wf::geometry_t panel = {0, 31, 1921, 1048};
+
+    std::unique_ptr<tree_node_t> root = std::make_unique<split_node_t>(SPLIT_VERTICAL);
+    root->set_geometry(full);
+    for (int i = 0; i < 7; i++)
+    {
+        auto column = std::make_unique<split_node_t>(SPLIT_HORIZONTAL);
+        for (int j = 0; j < 3; j++)
+        {
+            column->add_child(headless::create_view_node());
+        }
+
+        root->as_split_node()->add_child(std::move(column));
+    }
+
+    root->set_gaps({3, 4, 5, 6, 7});
+    lay_out(root);
+    auto initial = view_geometries(root);
+
+    /* A panel is shown and hidden repeatedly */
+    auto restored = get_stats().layouts_restored;
+    for (int i = 0; i < 5; i++)
+    {
+        root->set_geometry(panel);
+        lay_out(root);
+        root->set_geometry(full);
+        lay_out(root);
+    }
+
+    CHECK(view_geometries(root) == initial);
+    CHECK(get_stats().layouts_restored > restored);
+
+    /* A split direction is toggled back */
+    auto column = root->as_split_node()->get_child(2)->as_split_node();
+    column->set_split_direction(SPLIT_VERTICAL);
+    lay_out(root);
+    column->set_split_direction(SPLIT_HORIZONTAL);
+    lay_out(root);
+    CHECK(view_geometries(root) == initial);
+
+    /* Adding and removing a view forgets the layouts, but new ones are
+     * remembered again */
+    column->add_child(headless::create_view_node());
+    lay_out(root);
+    column->remove_child(column->get_child(3));
+    lay_out(root);
+    auto relinked = view_geometries(root);
+    root->set_geometry(panel);
+    lay_out(root);
+    root->set_geometry(full);
+    lay_out(root);
+    CHECK(view_geometries(root) == relinked);
+
+    /* A resize by the user is kept when the panel toggles */
+    auto c0 = root->as_split_node()->get_child(0);
+    auto c1 = root->as_split_node()->get_child(1);
+    auto g0 = c0->geometry;
+    auto g1 = c1->geometry;
+    g0.width += 100;
+    g1.x     += 100;
+    g1.width -= 100;
+    c0->set_geometry(g0);
+    c1->set_geometry(g1);
+    lay_out(root);
+    auto edited = view_geometries(root);
+    for (int i = 0; i < 2; i++)
+    {
+        root->set_geometry(panel);
+        lay_out(root);
+        root->set_geometry(full);
+        lay_out(root);
+        CHECK(view_geometries(root) == edited);
+    }
+
+    /* Random trees cycle through a few workareas, and return to exactly the
+     * geometries they had the first time in each of them */
+    const wf::geometry_t workareas[] = {
+        full, panel, {0, 0, 1889, 1079}, {17, 23, 1800, 1001},
+    };
+
+    std::mt19937 rng(4);
+    for (int tree = 0; tree < 100; tree++)
+    {
+        auto random = test::make_random_tree(rng, 1 + rng() % 60, full);
+        std::map<int, std::vector<wf::geometry_t>> seen;
+        for (int step = 0; step < 40; step++)
+        {
+            int workarea = rng() % 4;
+            random->set_geometry(workareas[workarea]);
+            lay_out(random);
+
+            auto geometries = view_geometries(random);
+            if (seen.count(workarea))
+            {
+                CHECK(geometries == seen[workarea]);
+            } else
+            {
+                seen[workarea] = geometries;
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,49 @@
+#include "tree-search.hpp"
+#include "check.hpp"
+#include "random-tree.hpp"
+
+/*
+ * Checks that hit-testing through the leaf index finds the same view as the
+ * recursive walk of the tree it replaced, on random trees and points both
+ * inside and outside of the root.
+ */
+using namespace wf::tile;
+
+/** The walk of find_view_at() before the leaf index */
+static nonstd::observer_ptr<view_node_t> walk_view_at(
+    nonstd::observer_ptr<tree_node_t> node, wf::point_t input)
+{
+    if (node->as_view_node())
+    {
+        return node->as_view_node();
+    }
+
+    for (auto child : node->get_children())
+    {
+        if (child->geometry & input)
+        {
+            return walk_view_at(child, input);
+        }
+    }
+
+    return nullptr;
+}
+
+int main()
+{
+    std::mt19937 rng(1);
+    for (int tree = 0; tree < 200; tree++)
+    {
+        auto root = test::make_random_tree(rng, 1 + rng() % 300);
+        for (int i = 0; i < 5000; i++)
+        {
+            wf::point_t point = {(int)(rng() % 2200), (int)(rng() % 1200)};
+            auto indexed = find_view_at(root, point);
+            auto walked  = walk_view_at(root, point);
+            CHECK_MSG(indexed == walked, "tree %d, point %d,%d", tree,
+                point.x, point.y);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,76 @@
+#include <random>
+
+#include "pair-resize.hpp"
+#include "check.hpp"
+#include "random-tree.hpp"
+
+/*
+ * Checks that a preview resize which is stopped without a release, like the
+ * resize controller is when a view is attached or the workspace changes,
+ * leaves the views configured with the geometries of their nodes.
+ */
+using namespace wf::tile;
+
+/** Check that every view was configured with the geometry of its node */
+static bool views_match_nodes(nonstd::observer_ptr<tree_node_t> root)
+{
+    std::vector<nonstd::observer_ptr<view_node_t>> views;
+    test::collect_views(root, views);
+    for (auto& view : views)
+    {
+        if (headless::get_headless_view(view)->current !=
+            view->calculate_target_geometry())
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main()
+{
+    std::mt19937 rng(11);
+    int moved_trees = 0;
+    for (int iteration = 0; iteration < 200; iteration++)
+    {
+        auto root = test::make_random_tree(rng, 2 + rng() % 12);
+        CHECK(views_match_nodes(root));
+
+        std::vector<nonstd::observer_ptr<view_node_t>> views;
+        test::collect_views(root, views);
+        auto grabbed = views[rng() % views.size()];
+        auto center  = grabbed->geometry;
+        wf::point_t grab = {center.x + center.width / 2,
+            center.y + center.height / 2};
+
+        /* The controller starts a preview resize and previews each motion */
+        pair_resize_t resize{
+            find_resizing_pair(grabbed, (rng() % 2) ? INSERT_ABOVE : INSERT_BELOW),
+            find_resizing_pair(grabbed, (rng() % 2) ? INSERT_LEFT : INSERT_RIGHT),
+            grab};
+        CHECK(!resize.has_preview());
+
+        for (int step = 0; step < 4; step++)
+        {
+            grab.x += (int)(rng() % 201) - 100;
+            grab.y += (int)(rng() % 201) - 100;
+            resize.move(grab);
+            resize.preview(root);
+            CHECK(resize.has_preview());
+        }
+
+        moved_trees += !views_match_nodes(root);
+
+        /* Destroying the controller commits what was previewed */
+        headless::headless_transaction_t tx;
+        resize.commit(root, tx);
+        tx.apply();
+        CHECK(!resize.has_preview());
+        CHECK(views_match_nodes(root));
+    }
+
+    /* Most resizes move an edge, otherwise the test checks nothing */
+    CHECK(moved_trees > 100);
+    return EXIT_SUCCESS;
+}
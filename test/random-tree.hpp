@@ -0,0 +1,74 @@
+#ifndef WF_TILE_PLUGIN_TEST_RANDOM_TREE_HPP
+#define WF_TILE_PLUGIN_TEST_RANDOM_TREE_HPP
+
+#include <random>
+#include <vector>
+
+#include "headless/headless-view.hpp"
+
+/*
+ * Random trees for the tests, which compare the indexed searches of the core
+ * with the plain tree walks they replace.
+ */
+namespace test
+{
+using namespace wf::tile;
+
+/**
+ * Build a tree of num_views views. Each view is added at a random position
+ * of a random split, and every fourth view comes in a new nested split, a
+ * few of which are tabbed. The tree is laid out before it is returned.
+ */
+inline std::unique_ptr<tree_node_t> make_random_tree(std::mt19937& rng,
+    int num_views, wf::geometry_t geometry = {100, 50, 1900, 1000})
+{
+    std::unique_ptr<tree_node_t> root =
+        std::make_unique<split_node_t>(SPLIT_VERTICAL);
+    root->set_geometry(geometry);
+
+    std::vector<nonstd::observer_ptr<split_node_t>> splits = {
+        root->as_split_node()
+    };
+
+    for (int i = 0; i < num_views; i++)
+    {
+        auto parent = splits[rng() % splits.size()];
+        if (rng() % 4 == 0)
+        {
+            auto split = std::make_unique<split_node_t>(
+                (rng() % 2) ? SPLIT_VERTICAL : SPLIT_HORIZONTAL);
+            split->set_tabbed(rng() % 5 == 0);
+            split->add_child(headless::create_view_node());
+            splits.push_back(nonstd::make_observer(split.get()));
+            parent->add_child(std::move(split));
+        } else
+        {
+            int idx = rng() % (parent->get_children().size() + 1);
+            parent->add_child(headless::create_view_node(), idx);
+        }
+    }
+
+    headless::headless_transaction_t tx;
+    layout_tree(root, tx);
+    tx.apply();
+    return root;
+}
+
+/** Collect the view nodes of the tree, in depth-first order */
+inline void collect_views(nonstd::observer_ptr<tree_node_t> node,
+    std::vector<nonstd::observer_ptr<view_node_t>>& views)
+{
+    if (node->as_view_node())
+    {
+        views.push_back(node->as_view_node());
+        return;
+    }
+
+    for (auto child : node->get_children())
+    {
+        collect_views(child, views);
+    }
+}
+}
+
+#endif /* end of include guard: WF_TILE_PLUGIN_TEST_RANDOM_TREE_HPP */
@@ -0,0 +1,234 @@
+#include <set>
+
+#include "tree-search.hpp"
+#include "check.hpp"
+#include "random-tree.hpp"
+
+/*
+ * Checks the depth-based find_common_ancestor() and the cached
+ * find_resizing_pair() against the search with a set of ancestors which they
+ * replaced. Two trees are edited at random in between, and views are moved
+ * from one tree to the other, so that stale cache entries are caught.
+ */
+using namespace wf::tile;
+
+/** find_common_ancestor() with a set of the ancestors of a */
+static nonstd::observer_ptr<split_node_t> set_common_ancestor(
+    nonstd::observer_ptr<tree_node_t> a, nonstd::observer_ptr<tree_node_t> b,
+    nonstd::observer_ptr<tree_node_t>& a_child,
+    nonstd::observer_ptr<tree_node_t>& b_child)
+{
+    std::set<tree_node_t*> ancestors;
+    for (auto node : a->get_path())
+    {
+        ancestors.insert(node.get());
+    }
+
+    b_child = nullptr;
+    nonstd::observer_ptr<tree_node_t> common = b;
+    while (!ancestors.count(common.get()))
+    {
+        b_child = common;
+        common  = common->get_parent();
+    }
+
+    a_child = nullptr;
+    for (auto node : a->get_path())
+    {
+        if (node->get_parent() == common)
+        {
+            a_child = node;
+        }
+    }
+
+    return common->as_split_node();
+}
+
+/** find_resizing_pair() without cache, with set_common_ancestor() */
+static resizing_pair_t set_resizing_pair(nonstd::observer_ptr<view_node_t> view,
+    split_insertion_t direction)
+{
+    auto other = find_first_view_in_direction(view, direction);
+    if (!other)
+    {
+        return {nullptr, view};
+    }
+
+    resizing_pair_t pair;
+    set_common_ancestor(view, other, pair.first, pair.second);
+    if ((direction == INSERT_LEFT) || (direction == INSERT_ABOVE))
+    {
+        std::swap(pair.first, pair.second);
+    }
+
+    return pair;
+}
+
+/** Apply a random edit to the tree */
+static void edit_tree(std::mt19937& rng, nonstd::observer_ptr<tree_node_t> root)
+{
+    std::vector<nonstd::observer_ptr<view_node_t>> views;
+    test::collect_views(root, views);
+
+    std::vector<nonstd::observer_ptr<split_node_t>> splits;
+    for (auto& view : views)
+    {
+        splits.push_back(view->get_parent());
+    }
+
+    auto split = splits.empty() ? root->as_split_node() :
+        splits[rng() % splits.size()];
+    switch (rng() % 7)
+    {
+      case 0:
+      case 1:
+        split->add_child(headless::create_view_node(),
+            rng() % (split->get_children().size() + 1));
+        break;
+
+      case 2:
+      {
+        auto nested = std::make_unique<split_node_t>(
+            (rng() % 2) ? SPLIT_VERTICAL : SPLIT_HORIZONTAL);
+        nested->add_child(headless::create_view_node());
+        nested->add_child(headless::create_view_node());
+        split->add_child(std::move(nested));
+        break;
+      }
+
+      case 3:
+        if (views.size() > 2)
+        {
+            auto view = views[rng() % views.size()];
+            view->get_parent()->remove_child(view);
+        }
+
+        break;
+
+      case 4:
+        split->set_split_direction(
+            (rng() % 2) ? SPLIT_VERTICAL : SPLIT_HORIZONTAL);
+        break;
+
+      case 5:
+        split->set_tabbed(rng() % 4 == 0);
+        break;
+
+      default:
+        if ((split->get_children().size() >= 2) && !split->is_tabbed())
+        {
+            /* Move the edge between the first two children */
+            auto a  = split->get_child(0);
+            auto b  = split->get_child(1);
+            auto g1 = a->geometry;
+            auto g2 = b->geometry;
+            if (split->get_split_direction() == SPLIT_HORIZONTAL)
+            {
+                int d = (g1.height > 20) ? rng() % (g1.height / 2) : 0;
+                g1.height -= d;
+                g2.y -= d;
+                g2.height += d;
+            } else
+            {
+                int d = (g1.width > 20) ? rng() % (g1.width / 2) : 0;
+                g1.width -= d;
+                g2.x -= d;
+                g2.width += d;
+            }
+
+            a->set_geometry(g1);
+            b->set_geometry(g2);
+        }
+    }
+}
+
+static bool check_tree(std::mt19937& rng, nonstd::observer_ptr<tree_node_t> root)
+{
+    const split_insertion_t directions[] = {
+        INSERT_ABOVE, INSERT_BELOW, INSERT_LEFT, INSERT_RIGHT
+    };
+
+    std::vector<nonstd::observer_ptr<view_node_t>> views;
+    test::collect_views(root, views);
+    for (auto& view : views)
+    {
+        if ((view->geometry.width <= 0) || (view->geometry.height <= 0))
+        {
+            continue;
+        }
+
+        for (auto direction : directions)
+        {
+            if (find_resizing_pair(view, direction) !=
+                set_resizing_pair(view, direction))
+            {
+                return false;
+            }
+        }
+    }
+
+    for (size_t i = 0; i + 1 < views.size(); i++)
+    {
+        auto a = views[rng() % views.size()];
+        auto b = views[rng() % views.size()];
+        if (a == b)
+        {
+            continue;
+        }
+
+        nonstd::observer_ptr<tree_node_t> a_child, b_child, a_set, b_set;
+        auto common = find_common_ancestor(a, b, a_child, b_child);
+        if ((common != set_common_ancestor(a, b, a_set, b_set)) ||
+            (a_child != a_set) || (b_child != b_set))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main()
+{
+    std::mt19937 rng(5);
+    for (int tree = 0; tree < 1000; tree++)
+    {
+        std::unique_ptr<tree_node_t> roots[] = {
+            test::make_random_tree(rng, 1 + rng() % 20, {0, 0, 3000, 2000}),
+            test::make_random_tree(rng, 1 + rng() % 20, {3000, 0, 3000, 2000}),
+        };
+
+        for (int step = 0; step < 60; step++)
+        {
+            auto& root = roots[rng() % 2];
+            if (rng() % 10 == 0)
+            {
+                /* A view moves to the other tree */
+                std::vector<nonstd::observer_ptr<view_node_t>> views;
+                test::collect_views(root, views);
+                auto& other = (&root == &roots[0]) ? roots[1] : roots[0];
+                if (views.size() > 1)
+                {
+                    transplant_node(views[rng() % views.size()],
+                        other->as_split_node());
+                }
+            } else
+            {
+                edit_tree(rng, root);
+            }
+
+            headless::headless_transaction_t tx;
+            layout_tree(roots[0], tx);
+            layout_tree(roots[1], tx);
+            tx.apply();
+
+            for (auto& checked : roots)
+            {
+                CHECK_MSG(check_tree(rng, checked), "tree %d, step %d", tree,
+                    step);
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,172 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "tree-search.hpp"
+#include "check.hpp"
+#include "random-tree.hpp"
+
+/*
+ * Checks transplant_node(): a subtree moved to another tree keeps its
+ * structure and proportions, the splits it leaves empty are removed, and
+ * both trees stay consistent for the searches which index them.
+ */
+using namespace wf::tile;
+
+/** Check that the depths and indices kept by the arena match the tree */
+static bool is_consistent(nonstd::observer_ptr<tree_node_t> node)
+{
+    int idx = 0;
+    for (auto child : node->get_children())
+    {
+        if ((child->get_parent().get() != node.get()) ||
+            (child->get_sibling_index() != idx++) ||
+            (child->get_depth() != node->get_depth() + 1) ||
+            (child->arena != node->arena) || !is_consistent(child))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/** Check that every view of the tree is found at its center */
+static bool is_hit_testable(nonstd::observer_ptr<tree_node_t> root)
+{
+    std::vector<nonstd::observer_ptr<view_node_t>> views;
+    test::collect_views(root, views);
+    for (auto& view : views)
+    {
+        /* The views of a tabbed split overlap */
+        bool tabbed = false;
+        for (auto node : view->get_path())
+        {
+            tabbed |= node->as_split_node() && node->as_split_node()->is_tabbed();
+        }
+
+        if (tabbed || (view->geometry.width <= 0) || (view->geometry.height <= 0))
+        {
+            continue;
+        }
+
+        wf::point_t center = {
+            view->geometry.x + view->geometry.width / 2,
+            view->geometry.y + view->geometry.height / 2,
+        };
+        if (find_view_at(root, center) != view)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main()
+{
+    std::unique_ptr<tree_node_t> from = std::make_unique<split_node_t>(SPLIT_VERTICAL);
+    std::unique_ptr<tree_node_t> to   = std::make_unique<split_node_t>(SPLIT_VERTICAL);
+    from->set_geometry({0, 0, 1200, 600});
+    to->set_geometry({1200, 0, 600, 300});
+
+    /* from: [view, horizontal[vertical[view, view, view]]] */
+    from->as_split_node()->add_child(headless::create_view_node());
+    auto wrapper = std::make_unique<split_node_t>(SPLIT_HORIZONTAL);
+    auto subtree = std::make_unique<split_node_t>(SPLIT_VERTICAL);
+    auto moved   = nonstd::make_observer(subtree.get());
+    for (int i = 0; i < 3; i++)
+    {
+        subtree->add_child(headless::create_view_node());
+    }
+
+    wrapper->add_child(std::move(subtree));
+    from->as_split_node()->add_child(std::move(wrapper));
+
+    headless::headless_transaction_t tx;
+    layout_tree(from, tx);
+    tx.apply();
+
+    /* Give the subtree uneven proportions */
+    auto g0 = moved->get_child(0)->geometry;
+    auto g1 = moved->get_child(1)->geometry;
+    g0.width += 100;
+    g1.x     += 100;
+    g1.width -= 100;
+    moved->get_child(0)->set_geometry(g0);
+    moved->get_child(1)->set_geometry(g1);
+    layout_tree(from, tx);
+    tx.apply();
+
+    double ratio = (double)moved->get_child(0)->geometry.width /
+        moved->geometry.width;
+
+    auto remaining = transplant_node(moved, to->as_split_node());
+
+    /* The wrapper became empty and is removed */
+    CHECK(remaining.get() == from.get());
+    CHECK(from->get_children().size() == 1);
+    CHECK(to->get_children().size() == 1);
+    CHECK(moved->get_parent().get() == to.get());
+    CHECK(moved->get_children().size() == 3);
+    CHECK(is_consistent(from) && is_consistent(to));
+
+    layout_tree(from, tx);
+    layout_tree(to, tx);
+    tx.apply();
+
+    double new_ratio = (double)moved->get_child(0)->geometry.width /
+        moved->geometry.width;
+    CHECK(std::abs(ratio - new_ratio) < 0.01);
+    CHECK(is_hit_testable(from) && is_hit_testable(to));
+
+    /* Random subtrees moved back and forth between random trees */
+    std::mt19937 rng(3);
+    for (int tree = 0; tree < 200; tree++)
+    {
+        std::unique_ptr<tree_node_t> roots[] = {
+            test::make_random_tree(rng, 1 + rng() % 40, {0, 0, 1920, 1080}),
+            test::make_random_tree(rng, 1 + rng() % 40, {1920, 0, 1920, 1080}),
+        };
+
+        for (int step = 0; step < 20; step++)
+        {
+            int src = rng() % 2;
+            std::vector<nonstd::observer_ptr<view_node_t>> views;
+            test::collect_views(roots[src], views);
+            if (views.empty())
+            {
+                continue;
+            }
+
+            /* Move a view, or one of its ancestors below the root */
+            nonstd::observer_ptr<tree_node_t> node = views[rng() % views.size()];
+            while (node->get_parent()->get_parent() && (rng() % 2))
+            {
+                node = node->get_parent();
+            }
+
+            size_t num_moved = 0;
+            std::vector<nonstd::observer_ptr<view_node_t>> moved_views;
+            test::collect_views(node, moved_views);
+            num_moved = moved_views.size();
+
+            std::vector<nonstd::observer_ptr<view_node_t>> target_views;
+            test::collect_views(roots[1 - src], target_views);
+
+            transplant_node(node, roots[1 - src]->as_split_node());
+            CHECK(is_consistent(roots[0]) && is_consistent(roots[1]));
+
+            std::vector<nonstd::observer_ptr<view_node_t>> after;
+            test::collect_views(roots[1 - src], after);
+            CHECK(after.size() == target_views.size() + num_moved);
+
+            layout_tree(roots[0], tx);
+            layout_tree(roots[1], tx);
+            tx.apply();
+            CHECK(is_hit_testable(roots[0]) && is_hit_testable(roots[1]));
+        }
+    }
+
+    return EXIT_SUCCESS;
+}